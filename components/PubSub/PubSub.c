@@ -25,8 +25,10 @@
  *
  */
 #include "PubSub.h"
+#include "mem_alloc.h"
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 #include "esp_http_client.h"
 #include "cJSON.h"
 #include "freertos/FreeRTOS.h"
@@ -35,14 +37,88 @@
 #include "esp_log.h"
 #include <esp_crt_bundle.h>
 #include "jwt_manager.h"
-#include "mbedtls/base64.h"
+#include "base64_codec.h"
+#include "PubSubStream.h"
+#include "PubSubCompress.h"
+#include "PubSubRecvPool.h"
+#include "sdkconfig.h"
+
+#define PUBSUB_LITERAL_LEN(str) (sizeof(str) - 1)
 
 static const char *TAG = "PostPubSub";
 
+static const char pubsub_publish_url[] = "https://pubsub.googleapis.com/v1/projects/%s/topics/%s:publish";
+static const char pubsub_publish_prefix[] = "{\"messages\":[";
+static const char pubsub_publish_data[] = "{\"data\":\"";
+static const char pubsub_publish_attributes[] = "\",\"attributes\":{";
+static const char pubsub_publish_default_attribute[] = "\"key\":\"value\"";
+static const char pubsub_publish_message_end[] = "}}";
+static const char pubsub_publish_suffix[] = "]}";
+#if CONFIG_PUBSUB_COMPRESS
+static const char pubsub_publish_encoding_attribute[] =
+    ",\"" PUBSUB_COMPRESS_ATTRIBUTE "\":\"" PUBSUB_COMPRESS_ENCODING "\"";
+#endif
+static const char pubsub_pull_url[] = "https://pubsub.googleapis.com/v1/projects/%s/subscriptions/%s:pull";
+static const char pubsub_pull_payload[] = "{\"maxMessages\": %lu}";
+static const char pubsub_acknowledge_url[] = "https://pubsub.googleapis.com/v1/projects/%s/subscriptions/%s:acknowledge";
+
+static void response_discard(httpResponse *myResponse){
+    recvPoolRelease(myResponse->body);
+    myResponse->body = NULL;
+    myResponse->body_len = 0;
+    myResponse->body_size = 0;
+}
+
+/*
+ * Appends one piece of body. The buffer is taken on the first piece, sized
+ * for the whole body from Content-Length when the server sent one, and from
+ * the running estimate for this kind of request otherwise, so it normally
+ * never has to grow.
+ */
+static esp_err_t response_append(httpResponse *myResponse, esp_http_client_handle_t http, const char *data, size_t len){
+    size_t need = myResponse->body_len + len + 1;
+    if(myResponse->body == NULL){
+        int64_t content_length = esp_http_client_get_content_length(http);
+        size_t estimate = myResponse->estimate[myResponse->op];
+        size_t want = content_length > 0 ? (size_t)content_length + 1 : estimate;
+        // Spare room, so the buffer also fits the next, slightly larger response.
+        size_t slack = content_length > 0 ? want / 16 : estimate / 4;
+        if(myResponse->op == HTTP_TRACE_PULL && myResponse->pull_array_per_kib > 0){
+            // Room for the Message array parse_pull_body appends, and its alignment.
+            size_t array = want / 1024 * myResponse->pull_array_per_kib + myResponse->pull_array_per_kib;
+            want += array + sizeof(uint32_t);
+            slack += array / 8;
+        }
+        // The spare room must not push a buffer the pool would keep out of it.
+        if(want <= CONFIG_PUBSUB_RECV_POOL_MAX_KEEP && want + slack > CONFIG_PUBSUB_RECV_POOL_MAX_KEEP){
+            slack = CONFIG_PUBSUB_RECV_POOL_MAX_KEEP - want;
+        }
+        want += slack;
+        myResponse->body = recvPoolAcquire(want > need ? want : need, &myResponse->body_size);
+        if(myResponse->body == NULL){
+            return ESP_ERR_NO_MEM;
+        }
+    }else if(need > myResponse->body_size){
+        size_t want = myResponse->body_size * 2 > need ? myResponse->body_size * 2 : need;
+        if(need <= CONFIG_PUBSUB_RECV_POOL_MAX_KEEP && want > CONFIG_PUBSUB_RECV_POOL_MAX_KEEP){
+            want = CONFIG_PUBSUB_RECV_POOL_MAX_KEEP;
+        }
+        char *grown = recvPoolGrow(myResponse->body, want, &myResponse->body_size);
+        if(grown == NULL){
+            return ESP_ERR_NO_MEM;
+        }
+        myResponse->body = grown;
+    }
+    memcpy(myResponse->body + myResponse->body_len, data, len);
+    myResponse->body_len += len;
+    myResponse->body[myResponse->body_len] = '\0';
+    return ESP_OK;
+}
+
 static esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
-    static int total_len = 0;
-    static char *response_data = NULL;
-    httpResponse *myResponse = (httpResponse *)evt->user_data;
+    PubSubClient *client = (PubSubClient *)evt->user_data;
+    httpResponse *myResponse = &client->http_response;
+    httpTraceEvent(&client->trace, evt->event_id);
 
     switch (evt->event_id) {
        case HTTP_EVENT_ERROR:
@@ -50,66 +126,59 @@ static esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
             break;
         case HTTP_EVENT_ON_CONNECTED:
             ESP_LOGI(TAG, "HTTP_EVENT_ON_CONNECTED");
+            client->stats.connections++;
+            client->stats.requests_on_connection = 0;
             break;
         case HTTP_EVENT_ON_HEADER:
             ESP_LOGI(TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
             break;
         case HTTP_EVENT_ON_DATA:
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                response_data = (char *)malloc(evt->data_len + 1);
-                if(response_data == NULL){
-                    ESP_LOGE(TAG, "Failed to allocate memory for response");
-                    return ESP_FAIL; 
-                }
-                memcpy(response_data, evt->data, evt->data_len);
-                response_data[evt->data_len] = 0;
-                ESP_LOGI(TAG, "HTTP Response: %s", response_data);
-            }else{
-                if (response_data == NULL) {
-                    response_data = malloc(evt->data_len + 1);
-                    if (response_data == NULL) {
-                        ESP_LOGE(TAG, "Failed to allocate memory for response");
-                        return ESP_FAIL;
-                    }
-                    memcpy(response_data, evt->data, evt->data_len);
-                } else {
-                    char *temp = realloc(response_data, total_len + evt->data_len + 1);
-                    if (temp == NULL) {
-                        ESP_LOGE(TAG, "Failed to allocate memory for response");
-                        free(response_data);
-                        return ESP_FAIL;
-                    }
-                    response_data = temp;
-                    memcpy(response_data + total_len, evt->data, evt->data_len);
-                }
-                total_len += evt->data_len;
-                response_data[total_len] = 0; 
+            if (client->stream != NULL) {
+                // Streaming pull: tokenize in place, nothing is buffered here.
+                pullStreamFeed(client->stream, (const char *)evt->data, evt->data_len);
+            }else if (client->raw_response) {
+                // Streaming publish: the caller reads the body itself.
+            }else if (response_append(myResponse, evt->client, (const char *)evt->data, evt->data_len) != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to allocate memory for response");
+                response_discard(myResponse);
+                return ESP_FAIL;
+            }
+            break;
+        case HTTP_EVENT_ON_FINISH:
+            ESP_LOGI(TAG, "HTTP_EVENT_ON_FINISH");
+            // The connection stays open between requests, so the body is
+            // handed over here instead of waiting for the disconnect. The
+            // buffer itself changes owner, nothing is copied.
+            if(myResponse->body_len > 0){
+                size_t *estimate = &myResponse->estimate[myResponse->op];
+                *estimate = *estimate == 0 ? myResponse->body_len : *estimate - *estimate / 4 + myResponse->body_len / 4;
+                myResponse->response = myResponse->body;
+                myResponse->body = NULL;
+                myResponse->body_len = 0;
+                myResponse->body_size = 0;
             }
+            response_discard(myResponse);
+            myResponse->transfer_completed = true;
+            client->stats.requests++;
+            client->stats.requests_on_connection++;
             break;
         case HTTP_EVENT_DISCONNECTED:
             ESP_LOGI(TAG, "HTTP_EVENT_DISCONNETED");
-
-            if(total_len > 0){
-                myResponse->response = (char *)malloc(total_len + 1);
-                if (myResponse->response == NULL) {
-                    ESP_LOGE(TAG, "Failed to allocate memory for response");    
-                }else{
-                    strcpy(myResponse->response,response_data);
-                }
+            if(client->stats.connections > 0){
+                ESP_LOGI(TAG, "Connection %lu served %lu requests", (unsigned long)client->stats.connections,
+                                (unsigned long)client->stats.requests_on_connection);
             }
-            if(response_data != NULL){
-                free(response_data);
+            client->stats.last_connection_requests = client->stats.requests_on_connection;
+            if(client->stats.requests_on_connection > client->stats.max_connection_requests){
+                client->stats.max_connection_requests = client->stats.requests_on_connection;
             }
-            total_len = 0;
-            response_data = NULL;
-            myResponse->transfer_completed = true;
+            client->stats.requests_on_connection = 0;
+            // Drop any partial body left over from an aborted transfer.
+            response_discard(myResponse);
             break;
         case HTTP_EVENT_HEADERS_SENT: 
             ESP_LOGI(TAG, "HTTP_EVENT_HEADERS_SENT");
             break;
-        case HTTP_EVENT_ON_FINISH:
-            ESP_LOGI(TAG, "HTTP_EVENT_ON_FINISH");
-        break;
         default: 
             ESP_LOGI(TAG, "Unhandled event: %d", evt->event_id);
             break;
@@ -117,201 +186,1100 @@ static esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
     return ESP_OK;
 
 }
-void postMessage(char* access_token,PushMessage *myMsg,PubSubTopic *Topic){
-    httpResponse *myResponse = (httpResponse*)calloc(1,sizeof(myResponse));
-
-    esp_http_client_config_t config = {
-        .url = (char *)malloc(256),
-        .crt_bundle_attach = esp_crt_bundle_attach,
-        .event_handler = _http_event_handler,
-        .method = HTTP_METHOD_POST,
-        .timeout_ms = 10000,
-        .buffer_size_tx = 2048,
-        .user_data = myResponse,
-    };
 
-    snprintf(config.url, 256, "https://pubsub.googleapis.com/v1/projects/%s/topics/%s:publish", Topic->projectId, Topic->topicName);
+PubSubClient *new_PubSubClient(const char *access_token){
+    PubSubClient *client = (PubSubClient *)memCalloc(1, sizeof(PubSubClient));
+    if(client == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory for PubSubClient");
+        return NULL;
+    }
+    if(clientSetAccessToken(client, access_token) != ESP_OK){
+        strBuilderFree(&client->auth_header);
+        memFree(client);
+        return NULL;
+    }
+    return client;
+}
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+void delete_PubSubClient(PubSubClient *client){
+    if(client == NULL){
+        return;
+    }
+    if(client->http_client != NULL){
+        esp_http_client_cleanup(client->http_client);
+    }
+    ESP_LOGI(TAG, "Client closed after %lu requests on %lu connections", (unsigned long)client->stats.requests,
+                    (unsigned long)client->stats.connections);
+    recvPoolRelease(client->http_response.response);
+    response_discard(&client->http_response);
+    strBuilderFree(&client->auth_header);
+    strBuilderFree(&client->request_body);
+    strBuilderFree(&client->compress_buf);
+    memFree(client);
+}
 
-    char *auth_header = (char *)malloc(sizeof(char));
-    *auth_header ='\0';
-    concatStrings(&auth_header,"Bearer ");
-    concatStrings(&auth_header,access_token);
-    //ESP_LOGE(TAG, "auth_header : %s",auth_header);
+esp_err_t clientSetAccessToken(PubSubClient *client, const char *access_token){
+    if(client == NULL || access_token == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    // A refreshed token has the same length, so the header buffer is reused.
+    strBuilderReset(&client->auth_header);
+    if(!strBuilderAppend(&client->auth_header, "Bearer ", sizeof("Bearer ") - 1) ||
+       !strBuilderAppendStr(&client->auth_header, access_token)){
+        ESP_LOGE(TAG, "Failed to allocate memory for auth header");
+        return ESP_ERR_NO_MEM;
+    }
+    if(client->http_client != NULL){
+        esp_http_client_set_header(client->http_client, "Authorization", client->auth_header.buf);
+    }
+    return ESP_OK;
+}
 
-    esp_http_client_set_header(client, "Authorization", auth_header);
-    esp_http_client_set_header(client, "Content-Type", "application/json");
+static bool connection_was_dropped(esp_err_t err){
+    return err == ESP_ERR_HTTP_WRITE_DATA || err == ESP_ERR_HTTP_FETCH_HEADER ||
+           err == ESP_ERR_HTTP_CONNECTION_CLOSED || err == ESP_FAIL;
+}
 
-    cJSON *root = cJSON_CreateObject();
-    cJSON *messages = cJSON_CreateArray();
-    cJSON_AddItemToObject(root, "messages", messages);
+// Creates the session handle on first use, or points it at client->url.
+static esp_err_t client_prepare(PubSubClient *client){
+    if(client->http_client == NULL){
+        esp_http_client_config_t config = {
+            .url = client->url,
+            .crt_bundle_attach = esp_crt_bundle_attach,
+            .event_handler = _http_event_handler,
+            .method = HTTP_METHOD_POST,
+            .timeout_ms = PUBSUB_HTTP_TIMEOUT_MS,
+            .buffer_size_tx = PUBSUB_HTTP_BUFFER_SIZE_TX,
+            .keep_alive_enable = true,
+            .user_data = client,
+        };
+        client->http_client = esp_http_client_init(&config);
+        if(client->http_client == NULL){
+            ESP_LOGE(TAG, "Failed to initialise HTTP client");
+            return ESP_FAIL;
+        }
+        esp_http_client_set_header(client->http_client, "Authorization", client->auth_header.buf);
+        esp_http_client_set_header(client->http_client, "Content-Type", "application/json");
+    }else{
+        esp_http_client_set_url(client->http_client, client->url);
+        esp_http_client_set_method(client->http_client, HTTP_METHOD_POST);
+    }
+    return ESP_OK;
+}
 
-    cJSON *message = cJSON_CreateObject();
-    cJSON_AddItemToArray(messages, message);
+/*
+ * Statuses that can succeed unchanged later (expired token, timeout, rate
+ * limit, server trouble) map to ESP_ERR_HTTP_EAGAIN so callers keep the
+ * messages; any other error status is a rejection of the request itself.
+ */
+static esp_err_t status_to_err(int status){
+    if(status < 300){
+        return ESP_OK;
+    }
+    ESP_LOGE(TAG, "HTTP status %d", status);
+    if(status == 401 || status == 408 || status == 429 || status >= 500){
+        return ESP_ERR_HTTP_EAGAIN;
+    }
+    return ESP_ERR_INVALID_RESPONSE;
+}
 
-    char *encodeMsg = base64encodeData((unsigned char *)myMsg->message,strlen(myMsg->message));
-    cJSON_AddStringToObject(message, "data", encodeMsg);
+/*
+ * Sends one POST over the session connection. The client handle is created
+ * on first use and reused afterwards; if the server has closed the idle
+ * connection the request is retried once on a fresh connection. The
+ * request is traced as op.
+ */
+static esp_err_t client_perform(PubSubClient *client, http_trace_op_t op, const char *payload, int len){
+    client->http_response.response = NULL;
+    client->http_response.transfer_completed = false;
+    client->http_response.op = op;
+    response_discard(&client->http_response);
 
-    cJSON *attributes = cJSON_CreateObject();
-    cJSON_AddStringToObject(attributes, "key", "value");
-    cJSON_AddItemToObject(message, "attributes", attributes);
+    httpTraceBegin(&client->trace);
+    esp_err_t err = client_prepare(client);
+    if(err != ESP_OK){
+        httpTraceEnd(&client->trace, op, err);
+        return err;
+    }
+    esp_http_client_set_post_field(client->http_client, payload, len);
+    err = esp_http_client_perform(client->http_client);
 
-    char *jsonString = cJSON_Print(root);
-    //ESP_LOGI(TAG, "Json string : %s", jsonString);
-    esp_http_client_set_post_field(client, jsonString, strlen(jsonString));
-    esp_err_t err = esp_http_client_perform(client);
+    if(err != ESP_OK && connection_was_dropped(err) && client->stats.requests > 0){
+        ESP_LOGW(TAG, "Connection closed by server, reconnecting: %s", esp_err_to_name(err));
+        esp_http_client_close(client->http_client);
+        recvPoolRelease(client->http_response.response);
+        client->http_response.response = NULL;
+        response_discard(&client->http_response);
+        client->stats.reconnects++;
+        if(client->stream != NULL){
+            pullStreamReset(client->stream);
+        }
+        err = esp_http_client_perform(client->http_client);
+    }
+    if(err == ESP_OK){
+        err = status_to_err(esp_http_client_get_status_code(client->http_client));
+    }
+    httpTraceEnd(&client->trace, op, err);
+    return err;
+}
+
+// Length of str once escaped for the inside of a JSON string.
+static size_t json_escaped_len(const char *str){
+    size_t len = 0;
+    for(; *str != '\0'; str++){
+        unsigned char c = *str;
+        len += (c == '"' || c == '\\') ? 2 : (c < 0x20 ? 6 : 1);
+    }
+    return len;
+}
+
+static void append_json_escaped(StrBuilder *sb, const char *str){
+    static const char hex[] = "0123456789abcdef";
+    const char *run = str;
+    for(; *str != '\0'; str++){
+        unsigned char c = *str;
+        if(c != '"' && c != '\\' && c >= 0x20){
+            continue;
+        }
+        strBuilderAppend(sb, run, str - run);
+        if(c < 0x20){
+            const char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F] };
+            strBuilderAppend(sb, esc, sizeof(esc));
+        }else{
+            const char esc[2] = { '\\', (char)c };
+            strBuilderAppend(sb, esc, sizeof(esc));
+        }
+        run = str + 1;
+    }
+    strBuilderAppend(sb, run, str - run);
+}
+
+// Length of the attribute members of a message, without the braces around them.
+static size_t attributes_len(const PushMessage *myMsg){
+    if(myMsg->attribute_count == 0){
+        return PUBSUB_LITERAL_LEN(pubsub_publish_default_attribute);
+    }
+    size_t len = myMsg->attribute_count - 1;
+    for(size_t i = 0; i < myMsg->attribute_count; i++){
+        len += json_escaped_len(myMsg->attributes[i].key) + json_escaped_len(myMsg->attributes[i].value) +
+               PUBSUB_LITERAL_LEN("\"\":\"\"");
+    }
+    return len;
+}
+
+// Writes everything after the payload: the attributes object and the end of the message.
+static void append_attributes(StrBuilder *body, const PushMessage *myMsg, bool compressed){
+    strBuilderAppend(body, pubsub_publish_attributes, PUBSUB_LITERAL_LEN(pubsub_publish_attributes));
+    if(myMsg->attribute_count == 0){
+        strBuilderAppend(body, pubsub_publish_default_attribute, PUBSUB_LITERAL_LEN(pubsub_publish_default_attribute));
+    }
+    for(size_t i = 0; i < myMsg->attribute_count; i++){
+        strBuilderAppend(body, i > 0 ? ",\"" : "\"", i > 0 ? 2 : 1);
+        append_json_escaped(body, myMsg->attributes[i].key);
+        strBuilderAppend(body, "\":\"", 3);
+        append_json_escaped(body, myMsg->attributes[i].value);
+        strBuilderAppend(body, "\"", 1);
+    }
+#if CONFIG_PUBSUB_COMPRESS
+    if(compressed){
+        strBuilderAppend(body, pubsub_publish_encoding_attribute, PUBSUB_LITERAL_LEN(pubsub_publish_encoding_attribute));
+    }
+#endif
+    strBuilderAppend(body, pubsub_publish_message_end, PUBSUB_LITERAL_LEN(pubsub_publish_message_end));
+}
+
+/*
+ * Upper bound of the JSON one message takes in a publish body. With
+ * compression on, it assumes the encoding attribute is added to an
+ * uncompressed payload, which is never smaller than what is written.
+ */
+size_t pushMessageEncodedSize(const PushMessage *myMsg){
+    size_t len;
+    pushMessagePayload(myMsg, &len);
+    size_t size = PUBSUB_LITERAL_LEN(pubsub_publish_data) + BASE64_ENCODED_LEN(len, true) +
+                  PUBSUB_LITERAL_LEN(pubsub_publish_attributes) + attributes_len(myMsg) +
+                  PUBSUB_LITERAL_LEN(pubsub_publish_message_end);
+#if CONFIG_PUBSUB_COMPRESS
+    size += PUBSUB_LITERAL_LEN(pubsub_publish_encoding_attribute);
+#endif
+    return size;
+}
+
+#if CONFIG_PUBSUB_COMPRESS
+/*
+ * Compresses a payload into the client's staging buffer. Only output that
+ * is smaller than the input is accepted, so NULL means publish it as is.
+ */
+static const uint8_t *compress_payload(PubSubClient *client, const uint8_t *data, size_t len, size_t *packed_len){
+    if(len < CONFIG_PUBSUB_COMPRESS_MIN_SIZE || len > CONFIG_PUBSUB_COMPRESS_MAX_SIZE){
+        return NULL;
+    }
+    StrBuilder *scratch = &client->compress_buf;
+    strBuilderReset(scratch);
+    if(!strBuilderReserve(scratch, len) ||
+       heatshrinkCompress((uint8_t *)scratch->buf, len - 1, data, len, packed_len,
+                          CONFIG_PUBSUB_COMPRESS_WINDOW_BITS, CONFIG_PUBSUB_COMPRESS_LOOKAHEAD_BITS) != ESP_OK){
+        return NULL;
+    }
+    return (const uint8_t *)scratch->buf;
+}
+#endif
+
+/*
+ * Writes a compact publish body straight into body: fixed JSON around each
+ * message, with the payload base64-encoded in place between the quotes.
+ * Payloads are read from the caller's buffers here and nowhere else. The
+ * body is sized up front, so it is one allocation the first time and none
+ * once the buffer has grown to fit.
+ */
+static esp_err_t build_publish_body(PubSubClient *client, StrBuilder *body, PushMessage **msgs, size_t msg_count){
+    size_t total = PUBSUB_LITERAL_LEN(pubsub_publish_prefix) + PUBSUB_LITERAL_LEN(pubsub_publish_suffix) + msg_count - 1;
+    for(size_t i = 0; i < msg_count; i++){
+        total += pushMessageEncodedSize(msgs[i]);
+    }
+    strBuilderReset(body);
+    if(!strBuilderReserve(body, total)){
+        return ESP_ERR_NO_MEM;
+    }
+
+    strBuilderAppend(body, pubsub_publish_prefix, PUBSUB_LITERAL_LEN(pubsub_publish_prefix));
+    for(size_t i = 0; i < msg_count; i++){
+        size_t len;
+        const uint8_t *data = pushMessagePayload(msgs[i], &len);
+        bool compressed = false;
+#if CONFIG_PUBSUB_COMPRESS
+        size_t packed_len;
+        const uint8_t *packed = compress_payload(client, data, len, &packed_len);
+        if(packed != NULL){
+            data = packed;
+            len = packed_len;
+            compressed = true;
+        }
+#endif
+        if(i > 0){
+            strBuilderAppend(body, ",", 1);
+        }
+        strBuilderAppend(body, pubsub_publish_data, PUBSUB_LITERAL_LEN(pubsub_publish_data));
+        body->len += base64Encode(body->buf + body->len, body->size - body->len, data, len, BASE64_STANDARD, true);
+        append_attributes(body, msgs[i], compressed);
+    }
+    strBuilderAppend(body, pubsub_publish_suffix, PUBSUB_LITERAL_LEN(pubsub_publish_suffix));
+    return ESP_OK;
+}
+
+// Hands out the messageIds of a :publish response, which come back in publish order.
+static size_t parse_publish_response(const char *response, PushMessage **msgs, size_t msg_count){
+    size_t posted = 0;
+    cJSON *json_response = cJSON_Parse(response);
+    if (json_response == NULL) {
+        ESP_LOGE(TAG, "Failed to parse JSON response");
+        return 0;
+    }
+    cJSON *messageIds = cJSON_GetObjectItem(json_response, "messageIds");
+    if (cJSON_IsArray(messageIds)) {
+        cJSON *messageId = NULL;
+        cJSON_ArrayForEach(messageId, messageIds){
+            if(posted == msg_count || !cJSON_IsString(messageId)){
+                break;
+            }
+            PushMessage *myMsg = msgs[posted];
+            myMsg->message_id = memStrdup(messageId->valuestring);
+            if(myMsg->message_id ==  NULL){
+                ESP_LOGE(TAG, "Failed to allocate memory for response");
+                break;
+            }
+            myMsg->posted_ok = true;
+            ESP_LOGI(TAG, "Posted Message id: %s", myMsg->message_id);
+            posted++;
+        }
+    }
+    cJSON_Delete(json_response);
+    return posted;
+}
+
+static void mark_not_posted(PushMessage **msgs, size_t from, size_t msg_count){
+    for(size_t i = from; i < msg_count; i++){
+        msgs[i]->posted_error = true;
+    }
+}
+
+// Sends a body built by build_publish_body and hands out the message ids.
+static esp_err_t post_encoded(PubSubClient *client, const StrBuilder *body, PushMessage **msgs, size_t msg_count,
+                              PubSubTopic *Topic){
+    snprintf(client->url, sizeof(client->url), pubsub_publish_url, Topic->projectId, Topic->topicName);
+    //ESP_LOGI(TAG, "Json string : %s", body->buf);
+    esp_err_t err = client_perform(client, HTTP_TRACE_PUBLISH, body->buf, body->len);
 
     if (err == ESP_OK) {
         ;
     } else {
         ESP_LOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(err));
     }
-    esp_http_client_cleanup(client);
-    
-    while(!myResponse->transfer_completed);
 
+    httpResponse *myResponse = &client->http_response;
     //ESP_LOGI(TAG,"Response : %s",myResponse->response);
 
+    size_t posted = 0;
     if (myResponse->response != NULL) {       
-        cJSON *json_response = cJSON_Parse(myResponse->response);
-        if (json_response == NULL) {
-            myMsg->posted_error = true;
-            ESP_LOGE(TAG, "Failed to parse JSON response");
-        } else {
-            cJSON *messageIds = cJSON_GetObjectItem(json_response, "messageIds");
-            if (cJSON_IsArray(messageIds)) {
-                int count = cJSON_GetArraySize(messageIds);
-
-                if(count){
-                    cJSON *messageId = cJSON_GetArrayItem(messageIds, 0);
-                    char *msg = messageId->valuestring;
-                    myMsg->message_id = (char *)malloc(strlen(msg)+1);
-                    if(myMsg->message_id ==  NULL){
-                        ESP_LOGE(TAG, "Failed to allocate memory for response");
-                        free(myResponse->response);
-                        cJSON_Delete(json_response);
-                        goto error;
-                    }
-                    strcpy(myMsg->message_id,msg);
-                    myMsg->posted_ok = true;
-                }
-            }
-            cJSON_Delete(json_response);
+        posted = parse_publish_response(myResponse->response, msgs, msg_count);
+        recvPoolRelease(myResponse->response);
+    }
+    mark_not_posted(msgs, posted, msg_count);
+
+    myResponse->response = NULL;
+    myResponse->transfer_completed = false;
+
+    if(err == ESP_OK && posted != msg_count){
+        err = ESP_ERR_INVALID_RESPONSE;
+    }
+    return err;
+}
+
+static esp_err_t post_messages(PubSubClient *client, PushMessage **msgs, size_t msg_count, PubSubTopic *Topic){
+    if(client == NULL || msgs == NULL || msg_count == 0){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(build_publish_body(client, &client->request_body, msgs, msg_count) != ESP_OK){
+        mark_not_posted(msgs, 0, msg_count);
+        return ESP_ERR_NO_MEM;
+    }
+    return post_encoded(client, &client->request_body, msgs, msg_count, Topic);
+}
+
+esp_err_t clientPostMessages(PubSubClient *client, PushMessage **msgs, size_t msg_count, PubSubTopic *Topic){
+    MemScope scope;
+    memScopeBegin(&scope, HTTP_TRACE_PUBLISH);
+    esp_err_t err = post_messages(client, msgs, msg_count, Topic);
+    memScopeEnd(&scope);
+    return err;
+}
+
+/*
+ * Encoding and sending a publish as two steps, so that the next body can be
+ * built while the previous one is on the wire. clientEncodeMessages() only
+ * touches body and the client's compression buffer; clientPostEncodedMessages()
+ * only the connection and its receive state. Each of them may therefore run
+ * on its own task, as long as no task calls both at the same time.
+ */
+esp_err_t clientEncodeMessages(PubSubClient *client, StrBuilder *body, PushMessage **msgs, size_t msg_count){
+    if(client == NULL || body == NULL || msgs == NULL || msg_count == 0){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(build_publish_body(client, body, msgs, msg_count) != ESP_OK){
+        mark_not_posted(msgs, 0, msg_count);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t clientPostEncodedMessages(PubSubClient *client, const StrBuilder *body, PushMessage **msgs, size_t msg_count,
+                                    PubSubTopic *Topic){
+    if(client == NULL || body == NULL || body->len == 0 || msgs == NULL || msg_count == 0){
+        return ESP_ERR_INVALID_ARG;
+    }
+    MemScope scope;
+    memScopeBegin(&scope, HTTP_TRACE_PUBLISH);
+    esp_err_t err = post_encoded(client, body, msgs, msg_count, Topic);
+    memScopeEnd(&scope);
+    return err;
+}
+
+void clientPostMessage(PubSubClient *client, PushMessage *myMsg, PubSubTopic *Topic){
+    clientPostMessages(client, &myMsg, 1, Topic);
+}
+
+static esp_err_t upload_write(PubSubClient *client, const char *data, size_t len){
+    while(len > 0){
+        int written = esp_http_client_write(client->http_client, data, len);
+        if(written <= 0){
+            ESP_LOGE(TAG, "Upload write failed");
+            return ESP_ERR_HTTP_WRITE_DATA;
+        }
+        data += written;
+        len -= written;
+    }
+    return ESP_OK;
+}
+
+/*
+ * Sends the body of a one-message :publish. The payload is pulled from the
+ * reader one chunk at a time and base64-encoded on its way out; the JSON
+ * after it is rendered into the idle request buffer.
+ */
+static esp_err_t upload_body(PubSubClient *client, const PushMessage *myMsg, size_t data_len, publish_reader_t reader,
+                             void *ctx, uint8_t *chunk, size_t chunk_size, char *encoded){
+    Base64Encoder enc;
+    base64EncoderInit(&enc, BASE64_STANDARD, true);
+    esp_err_t err = upload_write(client, pubsub_publish_prefix, PUBSUB_LITERAL_LEN(pubsub_publish_prefix));
+    if(err == ESP_OK){
+        err = upload_write(client, pubsub_publish_data, PUBSUB_LITERAL_LEN(pubsub_publish_data));
+    }
+    size_t remaining = data_len;
+    while(err == ESP_OK && remaining > 0){
+        size_t want = remaining < chunk_size ? remaining : chunk_size;
+        int n = reader(chunk, want, ctx);
+        if(n <= 0 || (size_t)n > want){
+            ESP_LOGE(TAG, "Reader stopped with %u bytes left", (unsigned)remaining);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        remaining -= n;
+        err = upload_write(client, encoded, base64EncoderUpdate(&enc, encoded, chunk, n));
+    }
+    if(err == ESP_OK){
+        err = upload_write(client, encoded, base64EncoderFinish(&enc, encoded));
+    }
+    if(err == ESP_OK){
+        StrBuilder *tail = &client->request_body;
+        strBuilderReset(tail);
+        append_attributes(tail, myMsg, false);
+        strBuilderAppend(tail, pubsub_publish_suffix, PUBSUB_LITERAL_LEN(pubsub_publish_suffix));
+        err = tail->failed ? ESP_ERR_NO_MEM : upload_write(client, tail->buf, tail->len);
+    }
+    return err;
+}
+
+// Reads the (small) publish response into the request buffer, which is idle during an upload.
+static esp_err_t upload_read_response(PubSubClient *client){
+    StrBuilder *response = &client->request_body;
+    strBuilderReset(response);
+    if(esp_http_client_fetch_headers(client->http_client) < 0){
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+    int status = esp_http_client_get_status_code(client->http_client);
+    while(true){
+        if(!strBuilderReserve(response, PUBSUB_UPLOAD_RESPONSE_READ_SIZE)){
+            return ESP_ERR_NO_MEM;
+        }
+        int n = esp_http_client_read_response(client->http_client, response->buf + response->len,
+                                              PUBSUB_UPLOAD_RESPONSE_READ_SIZE);
+        if(n < 0){
+            return ESP_FAIL;
+        }
+        if(n == 0){
+            break;
+        }
+        response->len += n;
+        response->buf[response->len] = '\0';
+    }
+    return status_to_err(status);
+}
+
+static esp_err_t post_message_stream(PubSubClient *client, PushMessage *myMsg, PubSubTopic *Topic,
+                                     size_t data_len, publish_reader_t reader, void *ctx){
+    if(client == NULL || myMsg == NULL || Topic == NULL || reader == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t content_length = PUBSUB_LITERAL_LEN(pubsub_publish_prefix) + PUBSUB_LITERAL_LEN(pubsub_publish_data) +
+                            BASE64_ENCODED_LEN(data_len, true) + PUBSUB_LITERAL_LEN(pubsub_publish_attributes) +
+                            attributes_len(myMsg) + PUBSUB_LITERAL_LEN(pubsub_publish_message_end) +
+                            PUBSUB_LITERAL_LEN(pubsub_publish_suffix);
+    if(content_length > INT_MAX){
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // The encode area also covers the up to two bytes carried over from a short read.
+    size_t chunk_size = CONFIG_PUBSUB_UPLOAD_CHUNK_SIZE / 3 * 3;
+    uint8_t *chunk = (uint8_t *)memAlloc(chunk_size + BASE64_ENCODED_LEN(chunk_size + 2, true));
+    if(chunk == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory for upload buffer");
+        myMsg->posted_error = true;
+        return ESP_ERR_NO_MEM;
+    }
+    char *encoded = (char *)chunk + chunk_size;
+
+    snprintf(client->url, sizeof(client->url), pubsub_publish_url, Topic->projectId, Topic->topicName);
+    httpTraceBegin(&client->trace);
+    esp_err_t err = client_prepare(client);
+    if(err == ESP_OK){
+        client->raw_response = true;
+        err = esp_http_client_open(client->http_client, (int)content_length);
+        if(err != ESP_OK && client->stats.requests > 0){
+            ESP_LOGW(TAG, "Connection closed by server, reconnecting: %s", esp_err_to_name(err));
+            esp_http_client_close(client->http_client);
+            client->stats.reconnects++;
+            err = esp_http_client_open(client->http_client, (int)content_length);
         }
-        free(myResponse->response);
-    }else {
+    }
+    if(err == ESP_OK){
+        err = upload_body(client, myMsg, data_len, reader, ctx, chunk, chunk_size, encoded);
+    }
+    memFree(chunk);
+    if(err == ESP_OK){
+        err = upload_read_response(client);
+        client->stats.requests++;
+        client->stats.requests_on_connection++;
+    }
+    // The open/write/read sequence leaves the handle mid-response, so the
+    // next request starts on a fresh connection.
+    if(client->http_client != NULL){
+        esp_http_client_close(client->http_client);
+    }
+    client->raw_response = false;
+
+    if(err == ESP_OK && parse_publish_response(client->request_body.buf, &myMsg, 1) != 1){
+        err = ESP_ERR_INVALID_RESPONSE;
+    }
+    httpTraceEnd(&client->trace, HTTP_TRACE_PUBLISH, err);
+    if(err != ESP_OK){
+        ESP_LOGE(TAG, "Streaming publish failed: %s", esp_err_to_name(err));
         myMsg->posted_error = true;
     }
+    return err;
+}
 
-    error:
+esp_err_t clientPostMessageStream(PubSubClient *client, PushMessage *myMsg, PubSubTopic *Topic,
+                                  size_t data_len, publish_reader_t reader, void *ctx){
+    MemScope scope;
+    memScopeBegin(&scope, HTTP_TRACE_PUBLISH);
+    esp_err_t err = post_message_stream(client, myMsg, Topic, data_len, reader, ctx);
+    memScopeEnd(&scope);
+    return err;
+}
 
-    myResponse->response = NULL;
-    myResponse->transfer_completed = false;
+static const char *json_skip_ws(const char *p, const char *end){
+    while(p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t' || *p == ',')){
+        p++;
+    }
+    return p;
+}
 
-    if(myMsg->posted_ok){
-        ESP_LOGI(TAG, "Posted Message id: %s", myMsg->message_id);
+static const char *json_skip_string(const char *p, const char *end){
+    for(p++; p < end; p++){
+        if(*p == '\\'){
+            p++;
+        }else if(*p == '"'){
+            return p + 1;
+        }
     }
+    return end;
+}
 
-    cJSON_Delete(root);
-    free(jsonString);
-    free(config.url);
+static const char *json_skip_value(const char *p, const char *end){
+    if(*p == '"'){
+        return json_skip_string(p, end);
+    }
+    if(*p == '{' || *p == '['){
+        int depth = 0;
+        while(p < end){
+            if(*p == '"'){
+                p = json_skip_string(p, end);
+                continue;
+            }
+            if(*p == '{' || *p == '['){
+                depth++;
+            }else if((*p == '}' || *p == ']') && --depth == 0){
+                return p + 1;
+            }
+            p++;
+        }
+        return end;
+    }
+    while(p < end && *p != ',' && *p != '}' && *p != ']'){
+        p++;
+    }
+    return p;
 }
 
-void pullMessages(char* access_token, PullMessage *myMsg, PubSubTopic *Topic){
-    httpResponse *myResponse = (httpResponse*)calloc(1,sizeof(myResponse));
-
-    esp_http_client_config_t config = {
-        .url = (char *)malloc(256),
-        .crt_bundle_attach = esp_crt_bundle_attach,
-        .event_handler = _http_event_handler,
-        .method = HTTP_METHOD_POST,
-        .timeout_ms = 10000,
-        .buffer_size_tx = 2048,
-        .user_data = myResponse,
-    };
+/*
+ * Finds a direct member of the JSON object text [obj, end). For string
+ * values the span excludes the quotes, for objects it covers the braces.
+ */
+static bool json_object_member(char *obj, const char *end, const char *key, char **value, size_t *value_len){
+    size_t key_len = strlen(key);
+    const char *p = json_skip_ws(obj, end);
+    if(p >= end || *p != '{'){
+        return false;
+    }
+    p++;
+    while(true){
+        p = json_skip_ws(p, end);
+        if(p >= end || *p != '"'){
+            return false;
+        }
+        const char *name = p + 1;
+        p = json_skip_string(p, end);
+        bool match = (size_t)(p - 1 - name) == key_len && memcmp(name, key, key_len) == 0;
+        while(p < end && *p != ':'){
+            p++;
+        }
+        p = json_skip_ws(p + 1, end);
+        if(p >= end){
+            return false;
+        }
+        const char *value_end = json_skip_value(p, end);
+        if(match){
+            if(*p == '"'){
+                *value = (char *)p + 1;
+                *value_len = value_end - p - 2;
+            }else{
+                *value = (char *)p;
+                *value_len = value_end - p;
+            }
+            return true;
+        }
+        p = value_end;
+    }
+}
 
-    snprintf(config.url, 256, "https://pubsub.googleapis.com/v1/projects/%s/subscriptions/%s:pull", Topic->projectId, Topic->subscription_id);
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+/*
+ * Turns one receivedMessages element inside the arena into a Message. The
+ * base64 payload is decoded over its own JSON text and the closing quotes
+ * of the id strings become their NUL terminators.
+ */
+static bool parse_received_message(char *arena, char *element, size_t len, Message *out){
+    const char *end = element + len;
+    char *ackId, *message, *data, *messageId, *publishTime;
+    size_t ackId_len, message_len, data_len, messageId_len, publishTime_len;
 
-    char *auth_header = (char *)malloc(sizeof(char));
-    *auth_header ='\0';
-    concatStrings(&auth_header,"Bearer ");
-    concatStrings(&auth_header,access_token);
-    //ESP_LOGE(TAG, "auth_header : %s",auth_header);
+    if(!json_object_member(element, end, "message", &message, &message_len)){
+        ESP_LOGE(TAG, "Received element without message");
+        return false;
+    }
+    if(!json_object_member(element, end, "ackId", &ackId, &ackId_len)){
+        ESP_LOGE(TAG, "Received message without ackId");
+        return false;
+    }
+    end = message + message_len;
+    if(!json_object_member(message, end, "messageId", &messageId, &messageId_len)){
+        ESP_LOGE(TAG, "Received message without messageId");
+        return false;
+    }
+    if(!json_object_member(message, end, "data", &data, &data_len)){
+        data = messageId + messageId_len;
+        data_len = 0;
+    }
+    if(!json_object_member(message, end, "publishTime", &publishTime, &publishTime_len)){
+        publishTime = messageId + messageId_len;
+        publishTime_len = 0;
+    }
+    // Looked up before data is decoded over its own text, which the scan walks past.
+    char *attributes, *encoding;
+    size_t attributes_len, encoding_len;
+    out->flags = 0;
+    if(json_object_member(message, end, "attributes", &attributes, &attributes_len) &&
+       json_object_member(attributes, attributes + attributes_len, PUBSUB_COMPRESS_ATTRIBUTE, &encoding, &encoding_len) &&
+       heatshrinkParseEncoding(encoding, encoding_len, &out->window_bits, &out->lookahead_bits)){
+        out->flags |= MESSAGE_FLAG_COMPRESSED;
+    }
 
-    esp_http_client_set_header(client, "Authorization", auth_header);
-    esp_http_client_set_header(client, "Content-Type", "application/json");
+    size_t decoded_len = 0;
+    if(data_len > 0 && base64Decode((uint8_t *)data, data_len, data, data_len, &decoded_len) != ESP_OK){
+        ESP_LOGE(TAG, "Base64 decode failed");
+        return false;
+    }
+    data[decoded_len] = '\0';
+    messageId[messageId_len] = '\0';
+    publishTime[publishTime_len] = '\0';
+    ackId[ackId_len] = '\0';
 
-    const char *payload = "{\"maxMessages\": 10}";
-    esp_http_client_set_post_field(client, payload, strlen(payload));
+    out->data_offset = data - arena;
+    out->data_len = decoded_len;
+    out->messageId_offset = messageId - arena;
+    out->publishTime_offset = publishTime - arena;
+    out->ackId_offset = ackId - arena;
+    return true;
+}
 
-    esp_err_t err = esp_http_client_perform(client);
+// Decompressed length of a tagged payload; false if it is corrupt or over budget.
+static bool inflated_size(const char *arena, const Message *msg, size_t *size){
+    if(heatshrinkDecompress(NULL, 0, messageData(arena, msg), msg->data_len, size,
+                            msg->window_bits, msg->lookahead_bits) != ESP_OK){
+        ESP_LOGW(TAG, "Message %s has a corrupt compressed payload", messageId(arena, msg));
+        return false;
+    }
+    if(*size > CONFIG_PUBSUB_DECOMPRESS_MAX_SIZE){
+        ESP_LOGW(TAG, "Message %s inflates to %u bytes, left compressed", messageId(arena, msg), (unsigned)*size);
+        return false;
+    }
+    return true;
+}
+
+// Decompresses a payload to arena + offset, which has room for room bytes and a NUL.
+static bool inflate_message(char *arena, Message *msg, size_t offset, size_t room){
+    size_t len;
+    if(heatshrinkDecompress((uint8_t *)arena + offset, room, messageData(arena, msg), msg->data_len, &len,
+                            msg->window_bits, msg->lookahead_bits) != ESP_OK){
+        return false;
+    }
+    arena[offset + len] = '\0';
+    msg->data_offset = offset;
+    msg->data_len = len;
+    msg->flags &= ~MESSAGE_FLAG_COMPRESSED;
+    return true;
+}
+
+/*
+ * Decompresses the tagged messages of a pull into the tail of the arena.
+ * All sizes are known before the arena grows, so it is resized once; the
+ * budget cap makes the messages rejected while sizing fail again quietly.
+ */
+static void inflate_pulled(PullMessage *myMsg){
+    size_t extra = 0, size;
+    for(int i = 0; i < myMsg->msg_count; i++){
+        Message *msg = &myMsg->message_array[i];
+        if((msg->flags & MESSAGE_FLAG_COMPRESSED) && inflated_size(myMsg->arena, msg, &size)){
+            extra += size + 1;
+        }
+    }
+    if(extra == 0){
+        return;
+    }
+    size_t array_offset = (char *)myMsg->message_array - myMsg->arena;
+    char *arena = recvPoolGrow(myMsg->arena, myMsg->arena_size + extra, NULL);
+    if(arena == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory to decompress messages");
+        return;
+    }
+    size_t tail = myMsg->arena_size;
+    myMsg->arena = arena;
+    myMsg->arena_size += extra;
+    myMsg->message_array = (Message *)(arena + array_offset);
+    for(int i = 0; i < myMsg->msg_count; i++){
+        Message *msg = &myMsg->message_array[i];
+        size_t room = myMsg->arena_size - tail - 1;
+        if(room > CONFIG_PUBSUB_DECOMPRESS_MAX_SIZE){
+            room = CONFIG_PUBSUB_DECOMPRESS_MAX_SIZE;
+        }
+        if((msg->flags & MESSAGE_FLAG_COMPRESSED) && inflate_message(arena, msg, tail, room)){
+            tail += msg->data_len + 1;
+        }
+    }
+}
+
+typedef struct{
+    PullMessage *pull;
+    int capacity;
+}arenaPullContext;
+
+static void count_element(char *json, size_t len, void *ctx){
+    (*(int *)ctx)++;
+}
+
+static void on_arena_element(char *json, size_t len, void *ctx){
+    arenaPullContext *arena_ctx = (arenaPullContext *)ctx;
+    PullMessage *myMsg = arena_ctx->pull;
+    if(myMsg->msg_count < arena_ctx->capacity &&
+       parse_received_message(myMsg->arena, json, len, &myMsg->message_array[myMsg->msg_count])){
+        myMsg->msg_count++;
+    }
+}
+
+/*
+ * The response body becomes the arena: messages are decoded inside it and
+ * the Message array is appended to the same block, which usually fits in
+ * the pooled buffer already. Takes ownership of body.
+ */
+static esp_err_t parse_pull_body(char *body, PullMessage *myMsg){
+    size_t body_len = strlen(body);
+    int count = 0;
+    PullStreamParser parser;
+    pullStreamInit(&parser, 0, count_element, &count);
+    if(pullStreamFeed(&parser, body, body_len) != ESP_OK || parser.depth != 0){
+        ESP_LOGE(TAG, "Failed to parse JSON response");
+        recvPoolRelease(body);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    ESP_LOGD(TAG,"Count : %d",count);
+
+    size_t array_offset = (body_len + 1 + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+    char *arena = recvPoolGrow(body, array_offset + count * sizeof(Message), NULL);
+    if(arena == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory for messages");
+        recvPoolRelease(body);
+        return ESP_ERR_NO_MEM;
+    }
+
+    myMsg->arena = arena;
+    myMsg->arena_size = array_offset + count * sizeof(Message);
+    myMsg->message_array = (Message *)(arena + array_offset);
+    arenaPullContext arena_ctx = {
+        .pull = myMsg,
+        .capacity = count,
+    };
+    pullStreamInit(&parser, 0, on_arena_element, &arena_ctx);
+    pullStreamFeed(&parser, arena, body_len);
+    inflate_pulled(myMsg);
+    return ESP_OK;
+}
+
+void freePullMessages(PullMessage *myMsg){
+    if(myMsg == NULL){
+        return;
+    }
+    recvPoolRelease(myMsg->arena);
+    myMsg->arena = NULL;
+    myMsg->arena_size = 0;
+    myMsg->message_array = NULL;
+    myMsg->msg_count = 0;
+}
+
+static void pull_messages(PubSubClient *client, PullMessage *myMsg, PubSubTopic *Topic, uint32_t max_messages){
+    snprintf(client->url, sizeof(client->url), pubsub_pull_url, Topic->projectId, Topic->subscription_id);
+
+    myMsg->arena = NULL;
+    myMsg->arena_size = 0;
+    myMsg->message_array = NULL;
+    myMsg->msg_count = 0;
+
+    char payload[PUBSUB_PULL_PAYLOAD_SIZE];
+    snprintf(payload, sizeof(payload), pubsub_pull_payload, (unsigned long)max_messages);
+    esp_err_t err = client_perform(client, HTTP_TRACE_PULL, payload, strlen(payload));
     if (err == ESP_OK) {
         ;
     } else {
         ESP_LOGE(TAG, "HTTP GET failed: %s", esp_err_to_name(err));
     }
 
-    esp_http_client_cleanup(client);
-    while(!myResponse->transfer_completed);
-
+    httpResponse *myResponse = &client->http_response;
     //ESP_LOGI(TAG,"Response : %s",myResponse->response);
 
-    cJSON *json_response = cJSON_Parse(myResponse->response);
-    if(json_response != NULL){
-        cJSON *receivedMessages = cJSON_GetObjectItem(json_response, "receivedMessages");
-        if(receivedMessages != NULL){
-            int count = cJSON_GetArraySize(receivedMessages);
-            myMsg->msg_count = count;
-            ESP_LOGI(TAG,"Count : %d",count);
-            Message *messages = (Message *)malloc(count * sizeof(Message));
-            if(messages != NULL){
-                for (int i = 0; i < count; i++) {
-                    cJSON *item = cJSON_GetArrayItem(receivedMessages, i);
-                    cJSON *message = cJSON_GetObjectItem(item, "message");
-
-                    char *encoded_data = cJSON_GetObjectItem(message, "data")->valuestring;
-                    char *messageId = cJSON_GetObjectItem(message, "messageId")->valuestring;
-                    char *publishTime = cJSON_GetObjectItem(message, "publishTime")->valuestring;
-
-                    messages[i].data = base64_decode(encoded_data);
-                    messages[i].messageId = strdup(messageId);
-                    messages[i].publishTime = strdup(publishTime);
-
-                    //ESP_LOGI(TAG,"data :%s , messageId:%s , PublishTime:%s" , messages[i].data,messages[i].messageId,messages[i].publishTime);
-                }
-                myMsg->message_array = messages;
-            }
-        }
-        cJSON_Delete(json_response);
-    }
-    if(myResponse->response != NULL){
-        free(myResponse->response);
+    if(err != ESP_OK || myResponse->response == NULL){
+        recvPoolRelease(myResponse->response);
+        myResponse->response = NULL;
+        myMsg->received_error = true;
+        return;
     }
+
+    char *body = myResponse->response;
     myResponse->response = NULL;
     myResponse->transfer_completed = false;
-    free(config.url);
+    if(parse_pull_body(body, myMsg) != ESP_OK){
+        myMsg->received_error = true;
+        return;
+    }
+    size_t array_size = (size_t)myMsg->msg_count * sizeof(Message);
+    if(array_size > 0){
+        size_t body_size = myMsg->arena_size - array_size;
+        myResponse->pull_array_per_kib = (uint32_t)((array_size * 1024 + body_size - 1) / body_size);
+    }
+    //ESP_LOGI(TAG,"data :%s , messageId:%s", messageData(arena, &myMsg->message_array[0]), messageId(arena, &myMsg->message_array[0]));
+    myMsg->received_ok = true;
 }
-static char *base64_decode(const char *encoded) {
-    size_t encoded_len = strlen(encoded);
-    size_t output_len = 0;
-    size_t decoded_buf_size = (encoded_len * 3) / 4;
 
-    char *decoded_data = (char *)malloc(decoded_buf_size + 1);  // +1 for null terminator
-    if (decoded_data == NULL) {
-        printf("Memory allocation failed\n");
-        return NULL;
+void clientPullMessagesMax(PubSubClient *client, PullMessage *myMsg, PubSubTopic *Topic, uint32_t max_messages){
+    MemScope scope;
+    memScopeBegin(&scope, HTTP_TRACE_PULL);
+    pull_messages(client, myMsg, Topic, max_messages);
+    memScopeEnd(&scope);
+}
+
+void clientPullMessages(PubSubClient *client, PullMessage *myMsg, PubSubTopic *Topic){
+    clientPullMessagesMax(client, myMsg, Topic, PUBSUB_PULL_MAX_MESSAGES);
+}
+
+typedef struct{
+    pull_message_callback_t on_message;
+    void *ctx;
+    int delivered;
+    StrBuilder *scratch;
+}streamPullContext;
+
+/*
+ * A compressed element is copied to the client's scratch buffer with room
+ * for its decompressed payload behind it, and that copy is delivered.
+ */
+static void on_stream_element(char *json, size_t len, void *ctx){
+    streamPullContext *stream_ctx = (streamPullContext *)ctx;
+    Message msg;
+    if(!parse_received_message(json, json, len, &msg)){
+        return;
+    }
+    char *arena = json;
+    size_t size;
+    if((msg.flags & MESSAGE_FLAG_COMPRESSED) && inflated_size(json, &msg, &size)){
+        StrBuilder *scratch = stream_ctx->scratch;
+        strBuilderReset(scratch);
+        if(strBuilderReserve(scratch, len + size) && strBuilderAppend(scratch, json, len)){
+            arena = scratch->buf;
+            inflate_message(arena, &msg, len, size);
+        }else{
+            ESP_LOGE(TAG, "Failed to allocate memory to decompress message");
+        }
     }
+    stream_ctx->delivered++;
+    stream_ctx->on_message(arena, &msg, stream_ctx->ctx);
+}
 
-    int ret = mbedtls_base64_decode((unsigned char *)decoded_data, decoded_buf_size, &output_len, 
-                                    (const unsigned char *)encoded, encoded_len);
-    if (ret != 0) {
-        printf("Base64 decode failed with error code: %d\n", ret);
-        free(decoded_data);
-        return NULL;
+static void stream_pull_messages(PubSubClient *client, PullMessage *myMsg, PubSubTopic *Topic,
+                                 pull_message_callback_t on_message, void *ctx){
+    snprintf(client->url, sizeof(client->url), pubsub_pull_url, Topic->projectId, Topic->subscription_id);
+
+    streamPullContext stream_ctx = {
+        .on_message = on_message,
+        .ctx = ctx,
+        .scratch = &client->compress_buf,
+    };
+    PullStreamParser parser;
+    pullStreamInit(&parser, CONFIG_PUBSUB_PULL_STREAM_MAX_MESSAGE_SIZE, on_stream_element, &stream_ctx);
+    client->stream = &parser;
+
+    char payload[PUBSUB_PULL_PAYLOAD_SIZE];
+    snprintf(payload, sizeof(payload), pubsub_pull_payload, (unsigned long)PUBSUB_PULL_MAX_MESSAGES);
+    esp_err_t err = client_perform(client, HTTP_TRACE_PULL, payload, strlen(payload));
+
+    client->stream = NULL;
+    myMsg->message_array = NULL;
+    myMsg->arena = NULL;
+    myMsg->msg_count = stream_ctx.delivered;
+    if(err == ESP_OK && parser.depth == 0){
+        myMsg->received_ok = true;
+    }else{
+        ESP_LOGE(TAG, "Streaming pull failed: %s", esp_err_to_name(err));
+        myMsg->received_error = true;
+    }
+    if(parser.skipped){
+        ESP_LOGW(TAG, "Skipped %lu oversized messages", (unsigned long)parser.skipped);
+    }
+    pullStreamFree(&parser);
+}
+
+void clientStreamPullMessages(PubSubClient *client, PullMessage *myMsg, PubSubTopic *Topic,
+                              pull_message_callback_t on_message, void *ctx){
+    MemScope scope;
+    memScopeBegin(&scope, HTTP_TRACE_PULL);
+    stream_pull_messages(client, myMsg, Topic, on_message, ctx);
+    memScopeEnd(&scope);
+}
+
+static esp_err_t acknowledge(PubSubClient *client, PubSubTopic *Topic, const char *body, size_t len){
+    if(client == NULL || Topic == NULL || body == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    snprintf(client->url, sizeof(client->url), pubsub_acknowledge_url, Topic->projectId, Topic->subscription_id);
+
+    esp_err_t err = client_perform(client, HTTP_TRACE_ACKNOWLEDGE, body, len);
+    if(err != ESP_OK){
+        ESP_LOGE(TAG, "Acknowledge failed: %s", esp_err_to_name(err));
+    }
+    recvPoolRelease(client->http_response.response);
+    client->http_response.response = NULL;
+    client->http_response.transfer_completed = false;
+    return err;
+}
+
+esp_err_t clientAcknowledge(PubSubClient *client, PubSubTopic *Topic, const char *body, size_t len){
+    MemScope scope;
+    memScopeBegin(&scope, HTTP_TRACE_ACKNOWLEDGE);
+    esp_err_t err = acknowledge(client, Topic, body, len);
+    memScopeEnd(&scope);
+    return err;
+}
+
+void postMessage(char* access_token,PushMessage *myMsg,PubSubTopic *Topic){
+    PubSubClient *client = new_PubSubClient(access_token);
+    if(client == NULL){
+        myMsg->posted_error = true;
+        return;
+    }
+    clientPostMessage(client, myMsg, Topic);
+    delete_PubSubClient(client);
+}
+
+void pullMessages(char* access_token, PullMessage *myMsg, PubSubTopic *Topic){
+    PubSubClient *client = new_PubSubClient(access_token);
+    if(client == NULL){
+        myMsg->received_error = true;
+        return;
+    }
+    clientPullMessages(client, myMsg, Topic);
+    delete_PubSubClient(client);
+}
+
+#if CONFIG_PUBSUB_BENCHMARK
+#include "micro_bench.h"
+
+#define PUBSUB_BENCHMARK_PAYLOAD_SIZE 64
+
+static const char bench_pull_message[] =
+    "{\"ackId\":\"UAYWLF1GSFE3GQhoUQ5PXiM_NSAoRRIJB08CKF15MEorQVh0Dj4NGXJ9YHxrWRMDAUdQfVxbEQ1peVxbB%08d\","
+    "\"message\":{\"data\":\"%s\",\"attributes\":{\"key\":\"value\"},\"messageId\":\"%d\","
+    "\"publishTime\":\"2026-10-17T00:00:00.000Z\"}}";
+
+// A :pull response of count messages, laid out the way Pub/Sub sends it.
+static bool bench_pull_body(StrBuilder *sb, int count, const char *data){
+    strBuilderReset(sb);
+    strBuilderAppendStr(sb, "{\"receivedMessages\":[");
+    for(int i = 0; i < count; i++){
+        if(i > 0){
+            strBuilderAppend(sb, ",", 1);
+        }
+        strBuilderAppendf(sb, bench_pull_message, i, data, i);
     }
-    
-    decoded_data[output_len] = '\0';
-    return decoded_data;
-}
\ No newline at end of file
+    strBuilderAppendStr(sb, "]}");
+    return !sb->failed;
+}
+
+/*
+ * Times building :publish bodies and parsing :pull responses of several
+ * sizes with 64-byte payloads. Each stage handles roughly the given number
+ * of messages in total, so large batches run fewer rounds. Every pull round copies the
+ * response first, like the HTTP handler does, since parsing consumes it.
+ */
+void pubsubBenchmark(int messages){
+    static const int batch_sizes[] = {1, 10, 100};
+    static const int pull_sizes[] = {1, 10, 100, 1000};
+    char name[32];
+    MicroBench bench;
+    uint8_t payload[PUBSUB_BENCHMARK_PAYLOAD_SIZE];
+    char data[BASE64_ENCODED_LEN(PUBSUB_BENCHMARK_PAYLOAD_SIZE, true) + 1];
+    static const PubSubAttribute attributes[] = { {"sensor", "imu0"} };
+    PushMessage *push = (PushMessage *)memCalloc(100, sizeof(PushMessage));
+    PushMessage **msgs = (PushMessage **)memCalloc(100, sizeof(PushMessage *));
+    PubSubClient *client = new_PubSubClient("benchmark");
+    StrBuilder response;
+    strBuilderInit(&response);
+    if(push == NULL || msgs == NULL || client == NULL){
+        ESP_LOGE(TAG, "Failed to allocate benchmark buffers");
+        goto cleanup;
+    }
+    // Readings that repeat, so that compression, when enabled, has work to do.
+    for(size_t i = 0; i < sizeof(payload); i++){
+        payload[i] = (uint8_t)(i % 16);
+    }
+    base64Encode(data, sizeof(data), payload, sizeof(payload), BASE64_STANDARD, true);
+    for(int i = 0; i < 100; i++){
+        pushMessageInit(&push[i], payload, sizeof(payload), attributes, 1);
+        msgs[i] = &push[i];
+    }
+
+    for(size_t s = 0; s < sizeof(batch_sizes) / sizeof(batch_sizes[0]); s++){
+        int count = batch_sizes[s];
+        int rounds = messages > count ? messages / count : 1;
+        snprintf(name, sizeof(name), "publish body x%d", count);
+        microBenchBegin(&bench, name, rounds);
+        for(int i = 0; i < rounds; i++){
+            build_publish_body(client, &client->request_body, msgs, count);
+        }
+        microBenchEnd(&bench);
+    }
+
+    for(size_t s = 0; s < sizeof(pull_sizes) / sizeof(pull_sizes[0]); s++){
+        int count = pull_sizes[s];
+        int rounds = messages > count ? messages / count : 1;
+        if(!bench_pull_body(&response, count, data)){
+            ESP_LOGE(TAG, "Failed to allocate a pull response of %d messages", count);
+            break;
+        }
+        snprintf(name, sizeof(name), "pull parse x%d", count);
+        microBenchBegin(&bench, name, rounds);
+        for(int i = 0; i < rounds; i++){
+            char *body = (char *)memAlloc(response.len + 1);
+            PullMessage pull = {0};
+            if(body == NULL){
+                break;
+            }
+            memcpy(body, response.buf, response.len + 1);
+            if(parse_pull_body(body, &pull) != ESP_OK || pull.msg_count != count){
+                ESP_LOGE(TAG, "Pull parse returned %d of %d messages", pull.msg_count, count);
+            }
+            freePullMessages(&pull);
+        }
+        microBenchEnd(&bench);
+    }
+
+cleanup:
+    strBuilderFree(&response);
+    delete_PubSubClient(client);
+    memFree(msgs);
+    memFree(push);
+}
+#endif
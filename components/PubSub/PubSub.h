@@ -29,6 +29,19 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include "str_builder.h"
+#include "http_trace.h"
+#include "sdkconfig.h"
+
+#define PUBSUB_URL_SIZE 256
+#define PUBSUB_HTTP_TIMEOUT_MS 10000
+#define PUBSUB_HTTP_BUFFER_SIZE_TX 2048
+#define PUBSUB_PULL_MAX_MESSAGES 10
+#define PUBSUB_PULL_PAYLOAD_SIZE 48
+#define PUBSUB_UPLOAD_RESPONSE_READ_SIZE 128
 
 typedef struct{
     char * topicName;
@@ -36,34 +49,178 @@ typedef struct{
     char * subscription_id;
 }PubSubTopic;
 
+typedef struct{
+    const char *key;
+    const char *value;
+}PubSubAttribute;
+
+/*
+ * A message to publish. The payload is data/data_len and may be binary;
+ * when data is NULL, message is sent as NUL-terminated text. Nothing is
+ * copied on the way in: the payload, the attribute array and its strings
+ * are read only when the request body is encoded. They must stay valid and
+ * unchanged until the publish call returns or, with a PubSubPublisher,
+ * until its callback has run for this message; from then on the buffer,
+ * e.g. a DMA buffer, belongs to the caller again. Attribute keys and values
+ * must not be NULL. Without attributes the message is sent with
+ * {"key":"value"}.
+ */
 typedef struct{
     char * message;
+    const uint8_t *data;
+    size_t data_len;
+    const PubSubAttribute *attributes;
+    size_t attribute_count;
     _Bool posted_ok;
     _Bool posted_error;
     char * message_id;
 }PushMessage;
 
+static inline void pushMessageInit(PushMessage *myMsg, const void *data, size_t data_len,
+                                   const PubSubAttribute *attributes, size_t attribute_count){
+    memset(myMsg, 0, sizeof(PushMessage));
+    myMsg->data = (const uint8_t *)data;
+    myMsg->data_len = data_len;
+    myMsg->attributes = attributes;
+    myMsg->attribute_count = attribute_count;
+}
+
+static inline const uint8_t *pushMessagePayload(const PushMessage *myMsg, size_t *len){
+    if(myMsg->data != NULL){
+        *len = myMsg->data_len;
+        return myMsg->data;
+    }
+    *len = myMsg->message != NULL ? strlen(myMsg->message) : 0;
+    return (const uint8_t *)myMsg->message;
+}
+
+#define MESSAGE_FLAG_COMPRESSED 0x01
+
+/*
+ * A received message is a set of offsets into the arena that holds the pull
+ * result. data is decoded in place and may be binary, use data_len; a NUL is
+ * still written after it for text payloads. The id strings are NUL terminated.
+ * Payloads tagged as compressed are inflated transparently; flags keeps
+ * MESSAGE_FLAG_COMPRESSED only if that failed and data is still compressed.
+ */
 typedef struct {
-    char *data;
-    char *messageId;
-    char *publishTime;
+    uint32_t data_offset;
+    uint32_t data_len;
+    uint32_t messageId_offset;
+    uint32_t publishTime_offset;
+    uint32_t ackId_offset;
+    uint16_t flags;
+    uint8_t window_bits;
+    uint8_t lookahead_bits;
 } Message;
 
 typedef struct{
     Message * message_array;
+    char *arena;
+    size_t arena_size;
     _Bool received_ok;
     _Bool received_error;
     int msg_count;
 }PullMessage;
 
+/*
+ * Receive state of one request. The event handler collects the body in a
+ * pooled buffer, sized once from Content-Length or, for chunked responses,
+ * from a running estimate per kind of request, and hands it over as
+ * response when the transfer finishes. A pull buffer also leaves room for
+ * the Message array the parse appends, at pull_array_per_kib bytes per KiB
+ * of body as seen on the last pull. It lives in the client, not in the
+ * handler, so clients on different tasks or cores can have requests in
+ * flight at the same time.
+ */
 typedef struct{
     char *response;
+    char *body;
+    size_t body_len;
+    size_t body_size;
+    http_trace_op_t op;
+    size_t estimate[HTTP_TRACE_OP_COUNT];
+    uint32_t pull_array_per_kib;
     _Bool transfer_completed;
 }httpResponse;
 
+/*
+ * Supplies the payload of a streaming publish. Fill up to size bytes of buf
+ * and return how many were written; returning 0 or less before the announced
+ * length has been delivered aborts the upload.
+ */
+typedef int (*publish_reader_t)(uint8_t *buf, size_t size, void *ctx);
+
+typedef void (*pull_message_callback_t)(const char *arena, const Message *msg, void *ctx);
+
+static inline const uint8_t *messageData(const char *arena, const Message *msg){
+    return (const uint8_t *)arena + msg->data_offset;
+}
+
+static inline const char *messageId(const char *arena, const Message *msg){
+    return arena + msg->messageId_offset;
+}
+
+static inline const char *messagePublishTime(const char *arena, const Message *msg){
+    return arena + msg->publishTime_offset;
+}
+
+static inline const char *messageAckId(const char *arena, const Message *msg){
+    return arena + msg->ackId_offset;
+}
+
+typedef struct{
+    uint32_t connections;
+    uint32_t reconnects;
+    uint32_t requests;
+    uint32_t requests_on_connection;
+    uint32_t last_connection_requests;
+    uint32_t max_connection_requests;
+}PubSubClientStats;
+
+/*
+ * Long lived Pub/Sub session. The underlying esp_http_client handle is kept
+ * open between calls so that publish and pull requests reuse one keep-alive
+ * TLS connection instead of paying DNS, TCP connect and handshake per message.
+ */
+typedef struct PubSubClient{
+    esp_http_client_handle_t http_client;
+    httpResponse http_response;
+    StrBuilder auth_header;
+    StrBuilder request_body;
+    StrBuilder compress_buf;
+    char url[PUBSUB_URL_SIZE];
+    struct PullStreamParser *stream;
+    _Bool raw_response;
+    PubSubClientStats stats;
+    HttpTrace trace;
+}PubSubClient;
+
+PubSubClient *new_PubSubClient(const char *access_token);
+void delete_PubSubClient(PubSubClient *client);
+esp_err_t clientSetAccessToken(PubSubClient *client, const char *access_token);
+size_t pushMessageEncodedSize(const PushMessage *myMsg);
+void clientPostMessage(PubSubClient *client, PushMessage *myMsg, PubSubTopic *Topic);
+esp_err_t clientPostMessages(PubSubClient *client, PushMessage **msgs, size_t msg_count, PubSubTopic *Topic);
+esp_err_t clientEncodeMessages(PubSubClient *client, StrBuilder *body, PushMessage **msgs, size_t msg_count);
+esp_err_t clientPostEncodedMessages(PubSubClient *client, const StrBuilder *body, PushMessage **msgs, size_t msg_count,
+                                    PubSubTopic *Topic);
+esp_err_t clientPostMessageStream(PubSubClient *client, PushMessage *myMsg, PubSubTopic *Topic,
+                                  size_t data_len, publish_reader_t reader, void *ctx);
+void clientPullMessages(PubSubClient *client, PullMessage *myMsg, PubSubTopic *Topic);
+void clientPullMessagesMax(PubSubClient *client, PullMessage *myMsg, PubSubTopic *Topic, uint32_t max_messages);
+void clientStreamPullMessages(PubSubClient *client, PullMessage *myMsg, PubSubTopic *Topic,
+                              pull_message_callback_t on_message, void *ctx);
+
+void freePullMessages(PullMessage *myMsg);
+esp_err_t clientAcknowledge(PubSubClient *client, PubSubTopic *Topic, const char *body, size_t len);
+
 void postMessage(char* access_token, PushMessage *myMsg,PubSubTopic *Topic);
 void pullMessages(char* access_token , PullMessage*,PubSubTopic*);
-static char *base64_decode(const char *encoded);
+
+#if CONFIG_PUBSUB_BENCHMARK
+void pubsubBenchmark(int messages);
+#endif
 
 #endif // WIFI_MANAGER_H
 
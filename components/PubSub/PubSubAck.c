@@ -0,0 +1,151 @@
+/**
+ * PubSubAck.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "PubSubAck.h"
+#include "mem_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "PubSubAck";
+static const char ack_body_prefix[] = "{\"ackIds\":[";
+static const char ack_body_suffix[] = "]}";
+
+static bool body_reset(PubSubAcker *acker){
+    acker->id_count = 0;
+    acker->first_ack_time = 0;
+    strBuilderReset(&acker->body);
+    return strBuilderAppend(&acker->body, ack_body_prefix, sizeof(ack_body_prefix) - 1);
+}
+
+PubSubAcker *new_PubSubAcker(PubSubClient *client, PubSubTopic *Topic, uint32_t max_ids, uint32_t max_delay_ms){
+    if(client == NULL || Topic == NULL){
+        return NULL;
+    }
+    PubSubAcker *acker = (PubSubAcker *)memCalloc(1, sizeof(PubSubAcker));
+    if(acker == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory for PubSubAcker");
+        return NULL;
+    }
+    acker->client = client;
+    acker->topic = Topic;
+    acker->max_ids = max_ids ? max_ids : CONFIG_PUBSUB_ACK_MAX_IDS;
+    acker->max_delay_ms = max_delay_ms ? max_delay_ms : CONFIG_PUBSUB_ACK_MAX_DELAY_MS;
+    strBuilderInit(&acker->body);
+    if(!body_reset(acker)){
+        strBuilderFree(&acker->body);
+        memFree(acker);
+        return NULL;
+    }
+    return acker;
+}
+
+void delete_PubSubAcker(PubSubAcker *acker){
+    if(acker == NULL){
+        return;
+    }
+    ackerFlush(acker);
+    ESP_LOGI(TAG, "Acknowledged : %lu , failed : %lu", (unsigned long)acker->acked, (unsigned long)acker->failed);
+    strBuilderFree(&acker->body);
+    memFree(acker);
+}
+
+esp_err_t ackerFlush(PubSubAcker *acker){
+    if(acker == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(acker->id_count == 0){
+        return ESP_OK;
+    }
+    esp_err_t err = ESP_ERR_NO_MEM;
+    if(strBuilderAppend(&acker->body, ack_body_suffix, sizeof(ack_body_suffix) - 1)){
+        err = clientAcknowledge(acker->client, acker->topic, acker->body.buf, acker->body.len);
+    }
+    if(err == ESP_OK){
+        acker->acked += acker->id_count;
+    }else{
+        // The messages will simply be redelivered after their ack deadline.
+        acker->failed += acker->id_count;
+    }
+    ESP_LOGI(TAG, "Acknowledged %lu messages in one request", (unsigned long)acker->id_count);
+    body_reset(acker);
+    return err;
+}
+
+uint32_t ackerTimeToFlushMs(PubSubAcker *acker){
+    if(acker == NULL || acker->id_count == 0){
+        return UINT32_MAX;
+    }
+    int64_t elapsed_ms = (esp_timer_get_time() - acker->first_ack_time) / 1000;
+    if(elapsed_ms >= acker->max_delay_ms){
+        return 0;
+    }
+    return acker->max_delay_ms - (uint32_t)elapsed_ms;
+}
+
+esp_err_t ackerFlushIfDue(PubSubAcker *acker){
+    if(acker == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(acker->id_count >= acker->max_ids || ackerTimeToFlushMs(acker) == 0){
+        return ackerFlush(acker);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ackerAdd(PubSubAcker *acker, const char *ackId){
+    if(acker == NULL || ackId == NULL || acker->body.buf == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t body_len = acker->body.len;
+    if((acker->id_count > 0 && !strBuilderAppend(&acker->body, ",", 1)) ||
+       !strBuilderAppend(&acker->body, "\"", 1) || !strBuilderAppendStr(&acker->body, ackId) ||
+       !strBuilderAppend(&acker->body, "\"", 1)){
+        strBuilderTruncate(&acker->body, body_len);
+        return ESP_ERR_NO_MEM;
+    }
+    if(acker->id_count == 0){
+        acker->first_ack_time = esp_timer_get_time();
+    }
+    acker->id_count++;
+    return ackerFlushIfDue(acker);
+}
+
+esp_err_t ackerAddPulled(PubSubAcker *acker, const PullMessage *myMsg){
+    if(acker == NULL || myMsg == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    for(int i = 0; i < myMsg->msg_count; i++){
+        esp_err_t add_err = ackerAdd(acker, messageAckId(myMsg->arena, &myMsg->message_array[i]));
+        if(add_err != ESP_OK){
+            err = add_err;
+        }
+    }
+    return err;
+}
@@ -0,0 +1,60 @@
+/**
+ * PubSubAck.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef PUBSUB_ACK_H
+#define PUBSUB_ACK_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "PubSub.h"
+
+/*
+ * Accumulates ackIds for one subscription and acknowledges them with a
+ * single :acknowledge request once max_ids is reached or the oldest pending
+ * ack is max_delay_ms old. The request body is built as ids are added, so
+ * ackIds are copied once and the pull arena can be released right away.
+ */
+typedef struct PubSubAcker{
+    PubSubClient *client;
+    PubSubTopic *topic;
+    uint32_t max_ids;
+    uint32_t max_delay_ms;
+    StrBuilder body;
+    uint32_t id_count;
+    int64_t first_ack_time;
+    uint32_t acked;
+    uint32_t failed;
+}PubSubAcker;
+
+PubSubAcker *new_PubSubAcker(PubSubClient *client, PubSubTopic *Topic, uint32_t max_ids, uint32_t max_delay_ms);
+void delete_PubSubAcker(PubSubAcker *acker);
+esp_err_t ackerAdd(PubSubAcker *acker, const char *ackId);
+esp_err_t ackerAddPulled(PubSubAcker *acker, const PullMessage *myMsg);
+esp_err_t ackerFlushIfDue(PubSubAcker *acker);
+esp_err_t ackerFlush(PubSubAcker *acker);
+uint32_t ackerTimeToFlushMs(PubSubAcker *acker);
+
+#endif // PUBSUB_ACK_H
@@ -0,0 +1,160 @@
+/**
+ * PubSubBatch.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "PubSubBatch.h"
+#include "mem_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "PubSubBatch";
+
+PubSubBatchSettings default_PubSubBatchSettings(){
+    PubSubBatchSettings settings = {
+        .max_messages = CONFIG_PUBSUB_BATCH_MAX_MESSAGES,
+        .max_bytes = CONFIG_PUBSUB_BATCH_MAX_BYTES,
+        .max_delay_ms = CONFIG_PUBSUB_BATCH_MAX_DELAY_MS,
+    };
+    return settings;
+}
+
+PubSubBatch *new_PubSubBatch(PubSubClient *client, PubSubTopic *Topic, const PubSubBatchSettings *settings){
+    if(client == NULL || Topic == NULL){
+        return NULL;
+    }
+    PubSubBatch *batch = (PubSubBatch *)memCalloc(1, sizeof(PubSubBatch));
+    if(batch == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory for PubSubBatch");
+        return NULL;
+    }
+    batch->client = client;
+    batch->topic = Topic;
+    batch->settings = settings ? *settings : default_PubSubBatchSettings();
+    if(batch->settings.max_messages == 0){
+        batch->settings.max_messages = 1;
+    }
+    batch->messages = (PushMessage **)memCalloc(batch->settings.max_messages, sizeof(PushMessage *));
+    if(batch->messages == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory for batch messages");
+        memFree(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+void delete_PubSubBatch(PubSubBatch *batch){
+    if(batch == NULL){
+        return;
+    }
+    batchFlush(batch);
+    memFree(batch->messages);
+    memFree(batch);
+}
+
+esp_err_t batchFlush(PubSubBatch *batch){
+    if(batch == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(batch->msg_count == 0){
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "Flushing %lu messages (%u bytes)", (unsigned long)batch->msg_count, (unsigned)batch->bytes);
+    esp_err_t err = batch->send != NULL ? batch->send(batch->messages, batch->msg_count, batch->send_ctx)
+                                        : clientPostMessages(batch->client, batch->messages, batch->msg_count, batch->topic);
+    if(batch->on_flush != NULL){
+        batch->on_flush(batch->messages, batch->msg_count, err, batch->on_flush_ctx);
+    }
+    batch->msg_count = 0;
+    batch->bytes = 0;
+    batch->first_message_time = 0;
+    return err;
+}
+
+void batchSetFlushCallback(PubSubBatch *batch, batch_flush_callback_t on_flush, void *ctx){
+    if(batch != NULL){
+        batch->on_flush = on_flush;
+        batch->on_flush_ctx = ctx;
+    }
+}
+
+void batchSetSender(PubSubBatch *batch, batch_send_t send, void *ctx){
+    if(batch != NULL){
+        batch->send = send;
+        batch->send_ctx = ctx;
+    }
+}
+
+uint32_t batchTimeToFlushMs(PubSubBatch *batch){
+    if(batch == NULL || batch->msg_count == 0){
+        return UINT32_MAX;
+    }
+    int64_t elapsed_ms = (esp_timer_get_time() - batch->first_message_time) / 1000;
+    if(elapsed_ms >= batch->settings.max_delay_ms){
+        return 0;
+    }
+    return batch->settings.max_delay_ms - (uint32_t)elapsed_ms;
+}
+
+esp_err_t batchFlushIfDue(PubSubBatch *batch){
+    if(batch == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(batch->msg_count >= batch->settings.max_messages ||
+       batch->bytes >= batch->settings.max_bytes ||
+       batchTimeToFlushMs(batch) == 0){
+        return batchFlush(batch);
+    }
+    return ESP_OK;
+}
+
+esp_err_t batchAddMessage(PubSubBatch *batch, PushMessage *myMsg){
+    if(batch == NULL || myMsg == NULL || (myMsg->message == NULL && myMsg->data == NULL)){
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    // The separating comma is counted too, so bytes tracks the body size.
+    size_t size = pushMessageEncodedSize(myMsg) + 1;
+
+    // Send what is queued first if this message would push the request over the byte limit.
+    if(batch->msg_count > 0 && batch->bytes + size > batch->settings.max_bytes){
+        err = batchFlush(batch);
+    }
+
+    myMsg->posted_ok = false;
+    myMsg->posted_error = false;
+    myMsg->message_id = NULL;
+
+    if(batch->msg_count == 0){
+        batch->first_message_time = esp_timer_get_time();
+    }
+    batch->messages[batch->msg_count++] = myMsg;
+    batch->bytes += size;
+
+    esp_err_t flush_err = batchFlushIfDue(batch);
+    return err != ESP_OK ? err : flush_err;
+}
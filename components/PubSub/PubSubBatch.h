@@ -0,0 +1,75 @@
+/**
+ * PubSubBatch.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef PUBSUB_BATCH_H
+#define PUBSUB_BATCH_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "PubSub.h"
+
+typedef struct{
+    uint32_t max_messages;
+    size_t max_bytes;
+    uint32_t max_delay_ms;
+}PubSubBatchSettings;
+
+typedef void (*batch_flush_callback_t)(PushMessage **msgs, uint32_t msg_count, esp_err_t err, void *ctx);
+typedef esp_err_t (*batch_send_t)(PushMessage **msgs, uint32_t msg_count, void *ctx);
+
+/*
+ * Collects PushMessages for one topic and sends them as a single :publish
+ * request once max_messages, max_bytes or max_delay_ms is reached. Queued
+ * messages are owned by the caller and must stay valid until the batch that
+ * holds them is flushed; each one gets its own message_id / posted_ok back.
+ * A send hook replaces the clientPostMessages() call of a flush, e.g. to
+ * hand the messages to another task; the msgs array is reused afterwards.
+ */
+typedef struct PubSubBatch{
+    PubSubClient *client;
+    PubSubTopic *topic;
+    PubSubBatchSettings settings;
+    PushMessage **messages;
+    uint32_t msg_count;
+    size_t bytes;
+    int64_t first_message_time;
+    batch_flush_callback_t on_flush;
+    void *on_flush_ctx;
+    batch_send_t send;
+    void *send_ctx;
+}PubSubBatch;
+
+PubSubBatchSettings default_PubSubBatchSettings();
+PubSubBatch *new_PubSubBatch(PubSubClient *client, PubSubTopic *Topic, const PubSubBatchSettings *settings);
+void delete_PubSubBatch(PubSubBatch *batch);
+void batchSetFlushCallback(PubSubBatch *batch, batch_flush_callback_t on_flush, void *ctx);
+void batchSetSender(PubSubBatch *batch, batch_send_t send, void *ctx);
+esp_err_t batchAddMessage(PubSubBatch *batch, PushMessage *myMsg);
+esp_err_t batchFlushIfDue(PubSubBatch *batch);
+esp_err_t batchFlush(PubSubBatch *batch);
+uint32_t batchTimeToFlushMs(PubSubBatch *batch);
+
+#endif // PUBSUB_BATCH_H
@@ -0,0 +1,209 @@
+/**
+ * PubSubCompress.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "PubSubCompress.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define HEATSHRINK_MIN_WINDOW_BITS 4
+#define HEATSHRINK_MAX_WINDOW_BITS 15
+#define HEATSHRINK_MIN_LOOKAHEAD_BITS 3
+
+typedef struct{
+    uint8_t *buf;
+    size_t size;
+    size_t pos;
+    uint8_t bit;
+}BitWriter;
+
+typedef struct{
+    const uint8_t *buf;
+    size_t len;
+    size_t bit_pos;
+}BitReader;
+
+static bool valid_params(uint8_t window_bits, uint8_t lookahead_bits){
+    return window_bits >= HEATSHRINK_MIN_WINDOW_BITS && window_bits <= HEATSHRINK_MAX_WINDOW_BITS &&
+           lookahead_bits >= HEATSHRINK_MIN_LOOKAHEAD_BITS && lookahead_bits < window_bits;
+}
+
+// Appends the low count bits of value, most significant first.
+static bool put_bits(BitWriter *w, uint32_t value, uint8_t count){
+    while(count-- > 0){
+        if(w->bit == 0){
+            if(w->pos == w->size){
+                return false;
+            }
+            w->buf[w->pos] = 0;
+        }
+        if(value & (1u << count)){
+            w->buf[w->pos] |= 0x80 >> w->bit;
+        }
+        if(++w->bit == 8){
+            w->bit = 0;
+            w->pos++;
+        }
+    }
+    return true;
+}
+
+static uint32_t get_bits(BitReader *r, uint8_t count){
+    uint32_t value = 0;
+    while(count-- > 0){
+        uint8_t byte = r->buf[r->bit_pos >> 3];
+        value = (value << 1) | ((byte >> (7 - (r->bit_pos & 7))) & 1);
+        r->bit_pos++;
+    }
+    return value;
+}
+
+static size_t bits_left(const BitReader *r){
+    return r->len * 8 - r->bit_pos;
+}
+
+esp_err_t heatshrinkCompress(uint8_t *out, size_t out_size, const uint8_t *in, size_t len, size_t *out_len,
+                             uint8_t window_bits, uint8_t lookahead_bits){
+    if(out == NULL || out_len == NULL || (in == NULL && len > 0) || !valid_params(window_bits, lookahead_bits)){
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t window = (size_t)1 << window_bits;
+    size_t max_match = (size_t)1 << lookahead_bits;
+    // A back-reference only pays off once it replaces more than its own size in literals.
+    size_t min_match = (1 + window_bits + lookahead_bits) / 9 + 1;
+    BitWriter w = { .buf = out, .size = out_size };
+
+    size_t pos = 0;
+    while(pos < len){
+        size_t limit = len - pos < max_match ? len - pos : max_match;
+        size_t best_len = 0, best_dist = 0;
+        size_t max_dist = pos < window ? pos : window;
+        for(size_t dist = 1; dist <= max_dist && best_len < limit; dist++){
+            const uint8_t *cand = in + pos - dist;
+            if(cand[0] != in[pos] || cand[best_len] != in[pos + best_len]){
+                continue;
+            }
+            size_t n = 1;
+            while(n < limit && cand[n] == in[pos + n]){
+                n++;
+            }
+            if(n > best_len){
+                best_len = n;
+                best_dist = dist;
+            }
+        }
+        bool ok;
+        if(best_len >= min_match){
+            ok = put_bits(&w, 0, 1) && put_bits(&w, best_dist - 1, window_bits) &&
+                 put_bits(&w, best_len - 1, lookahead_bits);
+            pos += best_len;
+        }else{
+            ok = put_bits(&w, 1, 1) && put_bits(&w, in[pos], 8);
+            pos++;
+        }
+        if(!ok){
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+    *out_len = w.pos + (w.bit != 0);
+    return ESP_OK;
+}
+
+esp_err_t heatshrinkDecompress(uint8_t *out, size_t out_size, const uint8_t *in, size_t len, size_t *out_len,
+                               uint8_t window_bits, uint8_t lookahead_bits){
+    if(out_len == NULL || (in == NULL && len > 0) || !valid_params(window_bits, lookahead_bits)){
+        return ESP_ERR_INVALID_ARG;
+    }
+    BitReader r = { .buf = in, .len = len };
+    size_t backref_bits = 1 + window_bits + lookahead_bits;
+    size_t o = 0;
+
+    // The stream ends when too few bits are left for a token: at most 7 bits of padding.
+    while(true){
+        size_t left = bits_left(&r);
+        if(left < 9 && left < backref_bits){
+            break;
+        }
+        if(get_bits(&r, 1)){
+            if(left < 9){
+                break;
+            }
+            uint8_t byte = (uint8_t)get_bits(&r, 8);
+            if(out != NULL){
+                if(o == out_size){
+                    return ESP_ERR_INVALID_SIZE;
+                }
+                out[o] = byte;
+            }
+            o++;
+            continue;
+        }
+        if(left < backref_bits){
+            break;
+        }
+        size_t dist = get_bits(&r, window_bits) + 1;
+        size_t count = get_bits(&r, lookahead_bits) + 1;
+        if(dist > o){
+            return ESP_ERR_INVALID_ARG;
+        }
+        if(out != NULL){
+            if(out_size - o < count){
+                return ESP_ERR_INVALID_SIZE;
+            }
+            // Byte by byte: the source may overlap what is being written.
+            for(size_t i = 0; i < count; i++){
+                out[o + i] = out[o + i - dist];
+            }
+        }
+        o += count;
+    }
+    *out_len = o;
+    return ESP_OK;
+}
+
+static bool parse_small_uint(const char **p, const char *end, uint8_t *value){
+    unsigned v = 0;
+    const char *start = *p;
+    while(*p < end && **p >= '0' && **p <= '9' && *p - start < 2){
+        v = v * 10 + (**p - '0');
+        (*p)++;
+    }
+    *value = (uint8_t)v;
+    return *p > start;
+}
+
+bool heatshrinkParseEncoding(const char *value, size_t len, uint8_t *window_bits, uint8_t *lookahead_bits){
+    const size_t prefix_len = sizeof(PUBSUB_COMPRESS_ENCODING_PREFIX) - 1;
+    const char *end = value + len;
+    if(len <= prefix_len || memcmp(value, PUBSUB_COMPRESS_ENCODING_PREFIX, prefix_len) != 0){
+        return false;
+    }
+    const char *p = value + prefix_len;
+    if(!parse_small_uint(&p, end, window_bits) || end - p < 3 || p[0] != '-' || p[1] != 'l'){
+        return false;
+    }
+    p += 2;
+    return parse_small_uint(&p, end, lookahead_bits) && p == end && valid_params(*window_bits, *lookahead_bits);
+}
@@ -0,0 +1,64 @@
+/**
+ * PubSubCompress.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef PUBSUB_COMPRESS_H
+#define PUBSUB_COMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#define PUBSUB_COMPRESS_STR_(x) #x
+#define PUBSUB_COMPRESS_STR(x) PUBSUB_COMPRESS_STR_(x)
+
+// Attribute that tags a compressed message, and its value for the configured codec.
+#define PUBSUB_COMPRESS_ATTRIBUTE "encoding"
+#define PUBSUB_COMPRESS_ENCODING_PREFIX "heatshrink-w"
+#if CONFIG_PUBSUB_COMPRESS
+#define PUBSUB_COMPRESS_ENCODING PUBSUB_COMPRESS_ENCODING_PREFIX PUBSUB_COMPRESS_STR(CONFIG_PUBSUB_COMPRESS_WINDOW_BITS) \
+                                 "-l" PUBSUB_COMPRESS_STR(CONFIG_PUBSUB_COMPRESS_LOOKAHEAD_BITS)
+_Static_assert(CONFIG_PUBSUB_COMPRESS_LOOKAHEAD_BITS < CONFIG_PUBSUB_COMPRESS_WINDOW_BITS,
+               "PUBSUB_COMPRESS_LOOKAHEAD_BITS must be smaller than PUBSUB_COMPRESS_WINDOW_BITS");
+#endif
+
+/*
+ * LZSS in the heatshrink bitstream format, so payloads can be decoded on
+ * the server with the stock heatshrink tools. A 1 bit is followed by a
+ * literal byte; a 0 bit by a back-reference of window_bits (distance - 1)
+ * and lookahead_bits (length - 1). Both sides work on whole buffers, so
+ * neither needs a window buffer: the only RAM is the caller's output.
+ */
+esp_err_t heatshrinkCompress(uint8_t *out, size_t out_size, const uint8_t *in, size_t len, size_t *out_len,
+                             uint8_t window_bits, uint8_t lookahead_bits);
+// With out == NULL only the decompressed length is computed.
+esp_err_t heatshrinkDecompress(uint8_t *out, size_t out_size, const uint8_t *in, size_t len, size_t *out_len,
+                               uint8_t window_bits, uint8_t lookahead_bits);
+// Parses "heatshrink-w<W>-l<L>"; false for any other encoding.
+bool heatshrinkParseEncoding(const char *value, size_t len, uint8_t *window_bits, uint8_t *lookahead_bits);
+
+#endif // PUBSUB_COMPRESS_H
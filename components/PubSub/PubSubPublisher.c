@@ -0,0 +1,506 @@
+/**
+ * PubSubPublisher.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "PubSubPublisher.h"
+#include "mem_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "PubSubPublisher";
+
+static void notify_result(PubSubPublisher *publisher, PublishRequest *request, esp_err_t err){
+    if(publisher->config.callback != NULL){
+        publisher->config.callback(request->message, err, publisher->config.callback_ctx);
+    }
+    if(request->notify_task != NULL){
+        xTaskNotify(request->notify_task, (uint32_t)err, eSetValueWithOverwrite);
+    }
+}
+
+static void report_result(PubSubPublisher *publisher, PublishRequest *request, esp_err_t err){
+    if(err == ESP_OK){
+        publisher->published++;
+    }else if(err == ESP_ERR_NOT_FINISHED){
+        publisher->stored++;
+    }else{
+        publisher->failed++;
+    }
+    notify_result(publisher, request, err);
+}
+
+/*
+ * Producers move the requests they drop from a full queue here, so their
+ * results are reported on this task like any other. A dropped wake-up of
+ * delete_PubSubPublisher has no message and is skipped; stop_requested
+ * still stops the task.
+ */
+static void report_dropped(PubSubPublisher *publisher){
+    PublishRequest request;
+    while(xQueueReceive(publisher->dropped_queue, &request, 0) == pdTRUE){
+        if(request.message != NULL){
+            publisher->dropped++;
+            notify_result(publisher, &request, ESP_ERR_NO_MEM);
+        }
+    }
+}
+
+// Everything but a rejection is worth keeping, including ESP_ERR_HTTP_EAGAIN.
+static bool should_store(esp_err_t err){
+    return err != ESP_OK && err != ESP_ERR_INVALID_RESPONSE;
+}
+
+static esp_err_t store_message(PubSubPublisher *publisher, PushMessage *myMsg){
+    esp_err_t err = storeAppend(publisher->config.store, myMsg);
+    return err == ESP_OK ? ESP_ERR_NOT_FINISHED : err;
+}
+
+static void complete_requests(PubSubPublisher *publisher, PublishRequest *requests, uint32_t count, esp_err_t err){
+    for(uint32_t i = 0; i < count; i++){
+        PublishRequest *request = &requests[i];
+        esp_err_t msg_err = request->message->posted_ok ? ESP_OK : (err != ESP_OK ? err : ESP_FAIL);
+        if(publisher->config.store != NULL && should_store(msg_err)){
+            msg_err = store_message(publisher, request->message);
+        }
+        report_result(publisher, request, msg_err);
+    }
+}
+
+// Batch messages are always flushed in the order they were queued, so the
+// first msg_count in-flight requests are the ones that were just flushed.
+static uint32_t take_in_flight(PubSubPublisher *publisher, PublishRequest *requests, uint32_t msg_count){
+    uint32_t done = msg_count < publisher->in_flight_count ? msg_count : publisher->in_flight_count;
+    if(requests != NULL){
+        memcpy(requests, publisher->in_flight, done * sizeof(PublishRequest));
+    }
+    publisher->in_flight_count -= done;
+    memmove(publisher->in_flight, publisher->in_flight + done, publisher->in_flight_count * sizeof(PublishRequest));
+    return done;
+}
+
+static void on_batch_flushed(PushMessage **msgs, uint32_t msg_count, esp_err_t err, void *ctx){
+    PubSubPublisher *publisher = (PubSubPublisher *)ctx;
+    uint32_t done = msg_count < publisher->in_flight_count ? msg_count : publisher->in_flight_count;
+    complete_requests(publisher, publisher->in_flight, done, err);
+    take_in_flight(publisher, NULL, done);
+}
+
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+/*
+ * A flush copies the batch into a free slot and encodes it on the publisher
+ * task; the network task sends the slots in order and hands them back
+ * through done_queue. The publisher task reports their results when it takes
+ * them back, so callbacks, counters and the store stay on that task.
+ */
+static void network_task(void *arg){
+    PubSubPublisher *publisher = (PubSubPublisher *)arg;
+    PublishSlot *slot;
+
+    while(xQueueReceive(publisher->send_queue, &slot, portMAX_DELAY) == pdTRUE && slot != NULL){
+        slot->err = clientPostEncodedMessages(publisher->client, &slot->body, slot->messages, slot->msg_count,
+                                              publisher->topic);
+        xQueueSendToBack(publisher->done_queue, &slot, portMAX_DELAY);
+        xTaskNotifyGive(publisher->task);
+    }
+    // A NULL slot is the stop request, returning it confirms the stop.
+    slot = NULL;
+    xQueueSendToBack(publisher->done_queue, &slot, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+static void wake_publisher(PubSubPublisher *publisher){
+    xTaskNotifyGive(publisher->task);
+}
+
+static void reclaim_slot(PubSubPublisher *publisher, PublishSlot *slot){
+    complete_requests(publisher, slot->requests, slot->msg_count, slot->err);
+    slot->msg_count = 0;
+    publisher->free_slots[publisher->free_count++] = slot;
+}
+
+static void reclaim_sent_slots(PubSubPublisher *publisher){
+    PublishSlot *slot;
+    while(xQueueReceive(publisher->done_queue, &slot, 0) == pdTRUE){
+        reclaim_slot(publisher, slot);
+    }
+}
+
+static void wait_for_slot(PubSubPublisher *publisher){
+    PublishSlot *slot;
+    xQueueReceive(publisher->done_queue, &slot, portMAX_DELAY);
+    reclaim_slot(publisher, slot);
+}
+
+// Waits until nothing is on the wire, so the client may be used directly.
+static void pipeline_wait_idle(PubSubPublisher *publisher){
+    while(publisher->free_count < PUBSUB_PUBLISHER_SLOTS){
+        wait_for_slot(publisher);
+    }
+}
+
+static esp_err_t pipeline_send(PushMessage **msgs, uint32_t msg_count, void *ctx){
+    PubSubPublisher *publisher = (PubSubPublisher *)ctx;
+    if(publisher->free_count == 0){
+        wait_for_slot(publisher);
+    }
+    PublishSlot *slot = publisher->free_slots[--publisher->free_count];
+    memcpy(slot->messages, msgs, msg_count * sizeof(PushMessage *));
+    slot->msg_count = take_in_flight(publisher, slot->requests, msg_count);
+
+    slot->err = clientEncodeMessages(publisher->client, &slot->body, slot->messages, msg_count);
+    if(slot->err != ESP_OK){
+        esp_err_t err = slot->err;
+        reclaim_slot(publisher, slot);
+        return err;
+    }
+    xQueueSendToBack(publisher->send_queue, &slot, portMAX_DELAY);
+    return ESP_OK;
+}
+
+static void pipeline_stop(PubSubPublisher *publisher){
+    PublishSlot *slot = NULL;
+    xQueueSendToBack(publisher->send_queue, &slot, portMAX_DELAY);
+    while(xQueueReceive(publisher->done_queue, &slot, portMAX_DELAY) == pdTRUE && slot != NULL){
+        reclaim_slot(publisher, slot);
+    }
+    publisher->network_task = NULL;
+}
+
+static esp_err_t pipeline_init(PubSubPublisher *publisher){
+    uint32_t max_messages = publisher->batch->settings.max_messages;
+    for(int i = 0; i < PUBSUB_PUBLISHER_SLOTS; i++){
+        PublishSlot *slot = &publisher->slots[i];
+        slot->messages = (PushMessage **)memCalloc(max_messages, sizeof(PushMessage *));
+        slot->requests = (PublishRequest *)memCalloc(max_messages, sizeof(PublishRequest));
+        if(slot->messages == NULL || slot->requests == NULL){
+            return ESP_ERR_NO_MEM;
+        }
+        publisher->free_slots[publisher->free_count++] = slot;
+    }
+    // One extra place in done_queue for the stop confirmation.
+    publisher->send_queue = xQueueCreate(PUBSUB_PUBLISHER_SLOTS + 1, sizeof(PublishSlot *));
+    publisher->done_queue = xQueueCreate(PUBSUB_PUBLISHER_SLOTS + 1, sizeof(PublishSlot *));
+    if(publisher->send_queue == NULL || publisher->done_queue == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+    if(xTaskCreatePinnedToCore(network_task, "pubsub_net", publisher->config.network_stack_size, publisher,
+                               publisher->config.task_priority, &publisher->network_task,
+                               publisher->config.network_core) != pdPASS){
+        publisher->network_task = NULL;
+        return ESP_FAIL;
+    }
+    // The slots complete the requests themselves, not the flush.
+    batchSetFlushCallback(publisher->batch, NULL, NULL);
+    batchSetSender(publisher->batch, pipeline_send, publisher);
+    return ESP_OK;
+}
+
+static void pipeline_free(PubSubPublisher *publisher){
+    if(publisher->network_task != NULL){
+        pipeline_stop(publisher);
+    }
+    for(int i = 0; i < PUBSUB_PUBLISHER_SLOTS; i++){
+        strBuilderFree(&publisher->slots[i].body);
+        memFree(publisher->slots[i].messages);
+        memFree(publisher->slots[i].requests);
+    }
+    if(publisher->send_queue != NULL){
+        vQueueDelete(publisher->send_queue);
+    }
+    if(publisher->done_queue != NULL){
+        vQueueDelete(publisher->done_queue);
+    }
+}
+#endif
+
+/*
+ * Waits for the next queued request. In pipeline mode producers and the
+ * network task both notify the task, so one wait also covers slots coming
+ * back; false then only means there is no request yet.
+ */
+static bool receive_request(PubSubPublisher *publisher, PublishRequest *request, TickType_t wait){
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+    reclaim_sent_slots(publisher);
+    if(xQueueReceive(publisher->queue, request, 0) == pdTRUE){
+        return true;
+    }
+    ulTaskNotifyTake(pdTRUE, wait);
+    reclaim_sent_slots(publisher);
+    return xQueueReceive(publisher->queue, request, 0) == pdTRUE;
+#else
+    return xQueueReceive(publisher->queue, request, wait) == pdTRUE;
+#endif
+}
+
+static void drain_store(PubSubPublisher *publisher){
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+    pipeline_wait_idle(publisher);
+#endif
+    storeDrain(publisher->config.store, publisher->client, publisher->topic);
+}
+
+/*
+ * The request goes into in_flight before the batch sees the message, since
+ * adding it can flush the batch it joins. A message the batch would reject
+ * is reported here instead and never takes an in_flight place.
+ */
+static void batch_request(PubSubPublisher *publisher, PublishRequest *request){
+    if(request->message->message == NULL && request->message->data == NULL){
+        report_result(publisher, request, ESP_ERR_INVALID_ARG);
+        return;
+    }
+    publisher->in_flight[publisher->in_flight_count++] = *request;
+    batchAddMessage(publisher->batch, request->message);
+}
+
+static void publisher_task(void *arg){
+    PubSubPublisher *publisher = (PubSubPublisher *)arg;
+    PublishRequest request;
+
+    while(true){
+        uint32_t wait_ms = batchTimeToFlushMs(publisher->batch);
+        uint32_t drain_ms = storeTimeToDrainMs(publisher->config.store);
+        wait_ms = drain_ms < wait_ms ? drain_ms : wait_ms;
+        TickType_t wait = wait_ms == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait_ms);
+
+        bool received = receive_request(publisher, &request, wait);
+        report_dropped(publisher);
+        if(publisher->stop_requested){
+            if(received && request.message != NULL){
+                batch_request(publisher, &request);
+            }
+            break;
+        }
+        if(received){
+            if(request.message == NULL){
+                continue;
+            }
+            if(storeCount(publisher->config.store) > 0){
+                // Older messages are still waiting in flash: queue behind them.
+                report_result(publisher, &request, store_message(publisher, request.message));
+            }else{
+                batch_request(publisher, &request);
+            }
+        }else{
+            batchFlushIfDue(publisher->batch);
+        }
+        if(storeTimeToDrainMs(publisher->config.store) == 0){
+            drain_store(publisher);
+        }
+    }
+
+    // Publish whatever is still queued before stopping.
+    while(xQueueReceive(publisher->queue, &request, 0) == pdTRUE){
+        if(request.message != NULL){
+            batch_request(publisher, &request);
+        }
+    }
+    batchFlush(publisher->batch);
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+    pipeline_wait_idle(publisher);
+#endif
+    report_dropped(publisher);
+
+    xSemaphoreGive(publisher->stopped);
+    vTaskDelete(NULL);
+}
+
+PubSubPublisherConfig default_PubSubPublisherConfig(){
+    PubSubPublisherConfig config = {
+        .queue_length = CONFIG_PUBSUB_PUBLISHER_QUEUE_LENGTH,
+#if CONFIG_PUBSUB_PUBLISHER_DROP_OLDEST
+        .overflow_policy = publisher_overflow_drop_oldest,
+#else
+        .overflow_policy = publisher_overflow_block,
+#endif
+        .enqueue_timeout_ms = CONFIG_PUBSUB_PUBLISHER_ENQUEUE_TIMEOUT_MS,
+        .task_stack_size = CONFIG_PUBSUB_PUBLISHER_TASK_STACK_SIZE,
+        .task_priority = CONFIG_PUBSUB_PUBLISHER_TASK_PRIORITY,
+        .task_core = tskNO_AFFINITY,
+        .batch_settings = default_PubSubBatchSettings(),
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+        .network_core = CONFIG_PUBSUB_PUBLISHER_NETWORK_CORE,
+        .network_stack_size = CONFIG_PUBSUB_PUBLISHER_NETWORK_STACK_SIZE,
+#endif
+    };
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+    config.task_core = CONFIG_PUBSUB_PUBLISHER_ENCODE_CORE;
+#endif
+    return config;
+}
+
+static void delete_queues(PubSubPublisher *publisher){
+    if(publisher->queue != NULL){
+        vQueueDelete(publisher->queue);
+    }
+    if(publisher->dropped_queue != NULL){
+        vQueueDelete(publisher->dropped_queue);
+    }
+    if(publisher->drop_lock != NULL){
+        vSemaphoreDelete(publisher->drop_lock);
+    }
+    if(publisher->stopped != NULL){
+        vSemaphoreDelete(publisher->stopped);
+    }
+}
+
+PubSubPublisher *new_PubSubPublisher(PubSubClient *client, PubSubTopic *Topic, const PubSubPublisherConfig *config){
+    if(client == NULL || Topic == NULL){
+        return NULL;
+    }
+    PubSubPublisher *publisher = (PubSubPublisher *)memCalloc(1, sizeof(PubSubPublisher));
+    if(publisher == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory for PubSubPublisher");
+        return NULL;
+    }
+    publisher->client = client;
+    publisher->topic = Topic;
+    publisher->config = config ? *config : default_PubSubPublisherConfig();
+
+    publisher->batch = new_PubSubBatch(client, Topic, &publisher->config.batch_settings);
+    if(publisher->batch == NULL){
+        goto error;
+    }
+    batchSetFlushCallback(publisher->batch, on_batch_flushed, publisher);
+
+    // A byte-limit flush runs before the new message joins the batch, so one
+    // extra slot is needed on top of a full batch.
+    publisher->in_flight = (PublishRequest *)memCalloc(publisher->batch->settings.max_messages + 1, sizeof(PublishRequest));
+    if(publisher->in_flight == NULL){
+        goto error;
+    }
+
+    publisher->queue = xQueueCreate(publisher->config.queue_length, sizeof(PublishRequest));
+    publisher->dropped_queue = xQueueCreate(publisher->config.queue_length, sizeof(PublishRequest));
+    publisher->drop_lock = xSemaphoreCreateMutex();
+    publisher->stopped = xSemaphoreCreateBinary();
+    if(publisher->queue == NULL || publisher->dropped_queue == NULL || publisher->drop_lock == NULL ||
+       publisher->stopped == NULL){
+        goto error;
+    }
+
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+    if(pipeline_init(publisher) != ESP_OK){
+        goto error;
+    }
+#endif
+
+    if(xTaskCreatePinnedToCore(publisher_task, "pubsub_pub", publisher->config.task_stack_size, publisher,
+                               publisher->config.task_priority, &publisher->task, publisher->config.task_core) != pdPASS){
+        goto error;
+    }
+    return publisher;
+
+    error:
+    ESP_LOGE(TAG, "Failed to start publisher");
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+    pipeline_free(publisher);
+#endif
+    delete_queues(publisher);
+    memFree(publisher->in_flight);
+    if(publisher->batch != NULL){
+        delete_PubSubBatch(publisher->batch);
+    }
+    memFree(publisher);
+    return NULL;
+}
+
+void delete_PubSubPublisher(PubSubPublisher *publisher){
+    if(publisher == NULL){
+        return;
+    }
+    // The flag is the stop request; the empty request only wakes the task
+    // and may be dropped by a producer without harm.
+    PublishRequest wake = {0};
+    publisher->stop_requested = true;
+    xQueueSendToBack(publisher->queue, &wake, portMAX_DELAY);
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+    wake_publisher(publisher);
+#endif
+    xSemaphoreTake(publisher->stopped, portMAX_DELAY);
+
+    ESP_LOGI(TAG, "Publisher stopped, published : %lu , failed : %lu , dropped : %lu , stored : %lu",
+             (unsigned long)publisher->published, (unsigned long)publisher->failed, (unsigned long)publisher->dropped,
+             (unsigned long)publisher->stored);
+
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+    pipeline_free(publisher);
+#endif
+    delete_queues(publisher);
+    delete_PubSubBatch(publisher->batch);
+    memFree(publisher->in_flight);
+    memFree(publisher);
+}
+
+esp_err_t publisherPostMessageNotify(PubSubPublisher *publisher, PushMessage *myMsg, TaskHandle_t notify_task){
+    if(publisher == NULL || myMsg == NULL || (myMsg->message == NULL && myMsg->data == NULL)){
+        return ESP_ERR_INVALID_ARG;
+    }
+    PublishRequest request = {
+        .message = myMsg,
+        .notify_task = notify_task,
+    };
+
+    if(publisher->config.overflow_policy == publisher_overflow_block){
+        if(xQueueSendToBack(publisher->queue, &request, pdMS_TO_TICKS(publisher->config.enqueue_timeout_ms)) != pdTRUE){
+            return ESP_ERR_TIMEOUT;
+        }
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+        wake_publisher(publisher);
+#endif
+        return ESP_OK;
+    }
+
+    // The dropped request goes to the publisher task, which reports it. The
+    // lock keeps a free place in dropped_queue between the check and the send.
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(publisher->drop_lock, portMAX_DELAY);
+    while(xQueueSendToBack(publisher->queue, &request, 0) != pdTRUE){
+        if(uxQueueSpacesAvailable(publisher->dropped_queue) == 0){
+            // The task has not even caught up with reporting drops.
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+        PublishRequest oldest;
+        if(xQueueReceive(publisher->queue, &oldest, 0) == pdTRUE){
+            ESP_LOGW(TAG, "Queue full, dropping oldest message");
+            xQueueSendToBack(publisher->dropped_queue, &oldest, 0);
+        }
+    }
+    xSemaphoreGive(publisher->drop_lock);
+    if(err != ESP_OK){
+        return err;
+    }
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+    wake_publisher(publisher);
+#endif
+    return ESP_OK;
+}
+
+esp_err_t publisherPostMessage(PubSubPublisher *publisher, PushMessage *myMsg){
+    return publisherPostMessageNotify(publisher, myMsg, NULL);
+}
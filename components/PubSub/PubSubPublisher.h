@@ -0,0 +1,137 @@
+/**
+ * PubSubPublisher.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef PUBSUB_PUBLISHER_H
+#define PUBSUB_PUBLISHER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "PubSub.h"
+#include "PubSubBatch.h"
+#include "PubSubStore.h"
+
+#define PUBSUB_PUBLISHER_SLOTS 2
+
+typedef void (*publish_callback_t)(PushMessage *myMsg, esp_err_t err, void *ctx);
+
+typedef enum{
+    publisher_overflow_block,
+    publisher_overflow_drop_oldest
+}publisher_overflow_policy;
+
+typedef struct{
+    uint32_t queue_length;
+    publisher_overflow_policy overflow_policy;
+    uint32_t enqueue_timeout_ms;
+    uint32_t task_stack_size;
+    UBaseType_t task_priority;
+    BaseType_t task_core;
+    PubSubBatchSettings batch_settings;
+    PubSubStore *store;
+    publish_callback_t callback;
+    void *callback_ctx;
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+    BaseType_t network_core;
+    uint32_t network_stack_size;
+#endif
+}PubSubPublisherConfig;
+
+typedef struct{
+    PushMessage *message;
+    TaskHandle_t notify_task;
+}PublishRequest;
+
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+// One flushed batch: its encoded body and the requests it completes.
+typedef struct{
+    StrBuilder body;
+    PushMessage **messages;
+    PublishRequest *requests;
+    uint32_t msg_count;
+    esp_err_t err;
+}PublishSlot;
+#endif
+
+/*
+ * Non-blocking publisher. Callers enqueue PushMessages and return at once;
+ * a dedicated task drains the bounded queue through a PubSubBatch and reports
+ * every result through the callback and/or a task notification whose value
+ * is the esp_err_t of that message. The PubSubClient handed to the publisher
+ * must not be used by other tasks while the publisher is running. A queued
+ * PushMessage and the buffers it points to are borrowed until its result
+ * is reported; a stored message has been copied to flash by then. All
+ * results, including ESP_ERR_NO_MEM for messages dropped from a full queue,
+ * are reported on the publisher task. If the task falls a whole queue of
+ * drops behind, the new message is refused with ESP_ERR_NO_MEM instead.
+ *
+ * With a store configured, messages that fail because Pub/Sub cannot be
+ * reached are appended to flash and reported as ESP_ERR_NOT_FINISHED. While
+ * the store holds anything, new messages go there too so order is kept, and
+ * the task drains it in batches at the store's drain rate.
+ *
+ * With CONFIG_PUBSUB_PUBLISHER_PIPELINE the task only batches and encodes,
+ * by default on core 0, and a network task on core 1 sends the bodies. There
+ * are two slots, so one batch is encoded while the other is on the wire.
+ * Results are still reported on the publisher task, in queue order.
+ */
+typedef struct PubSubPublisher{
+    PubSubClient *client;
+    PubSubTopic *topic;
+    PubSubPublisherConfig config;
+    QueueHandle_t queue;
+    TaskHandle_t task;
+    SemaphoreHandle_t stopped;
+    SemaphoreHandle_t drop_lock;
+    QueueHandle_t dropped_queue;
+    volatile bool stop_requested;
+    PubSubBatch *batch;
+    PublishRequest *in_flight;
+    uint32_t in_flight_count;
+    uint32_t published;
+    uint32_t failed;
+    uint32_t dropped;
+    uint32_t stored;
+#if CONFIG_PUBSUB_PUBLISHER_PIPELINE
+    PublishSlot slots[PUBSUB_PUBLISHER_SLOTS];
+    PublishSlot *free_slots[PUBSUB_PUBLISHER_SLOTS];
+    uint32_t free_count;
+    QueueHandle_t send_queue;
+    QueueHandle_t done_queue;
+    TaskHandle_t network_task;
+#endif
+}PubSubPublisher;
+
+PubSubPublisherConfig default_PubSubPublisherConfig();
+PubSubPublisher *new_PubSubPublisher(PubSubClient *client, PubSubTopic *Topic, const PubSubPublisherConfig *config);
+void delete_PubSubPublisher(PubSubPublisher *publisher);
+esp_err_t publisherPostMessage(PubSubPublisher *publisher, PushMessage *myMsg);
+esp_err_t publisherPostMessageNotify(PubSubPublisher *publisher, PushMessage *myMsg, TaskHandle_t notify_task);
+
+#endif // PUBSUB_PUBLISHER_H
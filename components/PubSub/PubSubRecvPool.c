@@ -0,0 +1,200 @@
+/**
+ * PubSubRecvPool.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "PubSubRecvPool.h"
+#include "mem_alloc.h"
+#include <stdbool.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+typedef struct{
+    char *buf;
+    size_t size;
+    bool in_use;
+}RecvPoolEntry;
+
+static RecvPoolEntry entries[CONFIG_PUBSUB_RECV_POOL_BUFFERS];
+static RecvPoolStats stats;
+static portMUX_TYPE pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Called with the lock held.
+static RecvPoolEntry *find_entry(const char *buf){
+    for(int i = 0; i < CONFIG_PUBSUB_RECV_POOL_BUFFERS; i++){
+        if(entries[i].buf == buf && entries[i].in_use){
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Picks the smallest free buffer that fits, else the largest free one to
+ * grow, else an empty slot. Called with the lock held; the entry is marked
+ * busy, so it can be resized after the lock is dropped.
+ */
+static RecvPoolEntry *take_entry(size_t size){
+    RecvPoolEntry *fit = NULL, *largest = NULL, *empty = NULL;
+    for(int i = 0; i < CONFIG_PUBSUB_RECV_POOL_BUFFERS; i++){
+        RecvPoolEntry *e = &entries[i];
+        if(e->in_use){
+            continue;
+        }
+        if(e->buf == NULL){
+            empty = empty != NULL ? empty : e;
+        }else if(e->size >= size){
+            fit = fit == NULL || e->size < fit->size ? e : fit;
+        }else{
+            largest = largest == NULL || e->size > largest->size ? e : largest;
+        }
+    }
+    RecvPoolEntry *e = fit != NULL ? fit : (largest != NULL ? largest : empty);
+    if(e != NULL){
+        e->in_use = true;
+    }
+    return e;
+}
+
+/*
+ * Returns a buffer of at least size bytes and stores its real size in
+ * capacity, which may be larger when a bigger buffer was free.
+ */
+char *recvPoolAcquire(size_t size, size_t *capacity){
+    size = size < RECV_POOL_MIN_SIZE ? RECV_POOL_MIN_SIZE : size;
+    portENTER_CRITICAL(&pool_lock);
+    stats.acquired++;
+    // A buffer that would not be kept must not push out one that would.
+    RecvPoolEntry *e = size <= CONFIG_PUBSUB_RECV_POOL_MAX_KEEP ? take_entry(size) : NULL;
+    portEXIT_CRITICAL(&pool_lock);
+
+    if(e == NULL){
+        char *buf = (char *)memAlloc(size);
+        portENTER_CRITICAL(&pool_lock);
+        stats.overflow++;
+        portEXIT_CRITICAL(&pool_lock);
+        *capacity = buf != NULL ? size : 0;
+        return buf;
+    }
+    if(e->size >= size){
+        portENTER_CRITICAL(&pool_lock);
+        stats.reused++;
+        portEXIT_CRITICAL(&pool_lock);
+        *capacity = e->size;
+        return e->buf;
+    }
+    // The old contents are not needed, so free and allocate instead of copying.
+    // An eighth more absorbs the slow creep of a growing response size.
+    size_t alloc = size + size / 8 < CONFIG_PUBSUB_RECV_POOL_MAX_KEEP ? size + size / 8 : CONFIG_PUBSUB_RECV_POOL_MAX_KEEP;
+    alloc = alloc > size ? alloc : size;
+    memFree(e->buf);
+    char *buf = (char *)memAlloc(alloc);
+    portENTER_CRITICAL(&pool_lock);
+    stats.allocated++;
+    e->buf = buf;
+    e->size = buf != NULL ? alloc : 0;
+    e->in_use = buf != NULL;
+    portEXIT_CRITICAL(&pool_lock);
+    *capacity = buf != NULL ? alloc : 0;
+    return buf;
+}
+
+/*
+ * Resizes a buffer to at least size bytes, keeping its contents; capacity
+ * may be NULL. Buffers that did not come from the pool are reallocated.
+ * On failure NULL is returned and buf is still valid.
+ */
+char *recvPoolGrow(char *buf, size_t size, size_t *capacity){
+    portENTER_CRITICAL(&pool_lock);
+    RecvPoolEntry *e = find_entry(buf);
+    if(e != NULL && e->size >= size){
+        portEXIT_CRITICAL(&pool_lock);
+        if(capacity != NULL){
+            *capacity = e->size;
+        }
+        return buf;
+    }
+    stats.grown++;
+    portEXIT_CRITICAL(&pool_lock);
+
+    char *grown = (char *)memRealloc(buf, size);
+    if(grown == NULL){
+        return NULL;
+    }
+    if(e != NULL){
+        portENTER_CRITICAL(&pool_lock);
+        e->buf = grown;
+        e->size = size;
+        portEXIT_CRITICAL(&pool_lock);
+    }
+    if(capacity != NULL){
+        *capacity = size;
+    }
+    return grown;
+}
+
+// Buffers that did not come from the pool are freed.
+void recvPoolRelease(char *buf){
+    if(buf == NULL){
+        return;
+    }
+    bool keep = false;
+    portENTER_CRITICAL(&pool_lock);
+    RecvPoolEntry *e = find_entry(buf);
+    if(e != NULL){
+        keep = e->size <= CONFIG_PUBSUB_RECV_POOL_MAX_KEEP;
+        e->in_use = false;
+        if(!keep){
+            e->buf = NULL;
+            e->size = 0;
+        }
+    }
+    portEXIT_CRITICAL(&pool_lock);
+    if(!keep){
+        memFree(buf);
+    }
+}
+
+// Returns the memory of every idle buffer to the heap.
+void recvPoolTrim(void){
+    for(int i = 0; i < CONFIG_PUBSUB_RECV_POOL_BUFFERS; i++){
+        char *buf = NULL;
+        portENTER_CRITICAL(&pool_lock);
+        if(!entries[i].in_use){
+            buf = entries[i].buf;
+            entries[i].buf = NULL;
+            entries[i].size = 0;
+        }
+        portEXIT_CRITICAL(&pool_lock);
+        memFree(buf);
+    }
+}
+
+RecvPoolStats recvPoolGetStats(void){
+    portENTER_CRITICAL(&pool_lock);
+    RecvPoolStats copy = stats;
+    portEXIT_CRITICAL(&pool_lock);
+    return copy;
+}
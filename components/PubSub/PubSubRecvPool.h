@@ -0,0 +1,59 @@
+/**
+ * PubSubRecvPool.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef PUBSUB_RECV_POOL_H
+#define PUBSUB_RECV_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RECV_POOL_MIN_SIZE 512
+
+/*
+ * Response bodies and pull arenas come from a small pool of buffers shared
+ * by all clients. A released buffer keeps its memory, and the next request
+ * takes the smallest free one that fits, so once the buffers have grown to
+ * the usual response sizes, receiving allocates nothing. Buffers larger than
+ * CONFIG_PUBSUB_RECV_POOL_MAX_KEEP are never pooled and go back to the heap
+ * on release; when every buffer is busy the request falls back to the heap
+ * as well. The pool
+ * is locked, so buffers can be taken and released on any task or core.
+ */
+typedef struct{
+    uint32_t acquired;
+    uint32_t reused;
+    uint32_t allocated;
+    uint32_t grown;
+    uint32_t overflow;
+}RecvPoolStats;
+
+char *recvPoolAcquire(size_t size, size_t *capacity);
+char *recvPoolGrow(char *buf, size_t size, size_t *capacity);
+void recvPoolRelease(char *buf);
+void recvPoolTrim(void);
+RecvPoolStats recvPoolGetStats(void);
+
+#endif // PUBSUB_RECV_POOL_H
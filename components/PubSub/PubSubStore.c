@@ -0,0 +1,531 @@
+/**
+ * PubSubStore.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "PubSubStore.h"
+#include "mem_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "PubSubStore";
+
+#define STORE_RECORD_SIZE(len) (sizeof(PubSubStoreRecord) + (((len) + 3) & ~(size_t)3))
+#define STORE_STATE_OPEN 0xFFFFFFFF
+#define STORE_STATE_SENT 0
+
+static uint32_t sector_of(uint32_t offset){
+    return offset / PUBSUB_STORE_SECTOR_SIZE;
+}
+
+static uint32_t next_sector_start(PubSubStore *store, uint32_t offset){
+    uint32_t sector = sector_of(offset) + 1;
+    return (sector == store->sector_count ? 0 : sector) * PUBSUB_STORE_SECTOR_SIZE;
+}
+
+// Maps the end of the last sector back to the start of the partition.
+static uint32_t wrap_offset(PubSubStore *store, uint32_t offset){
+    return offset == store->sector_count * PUBSUB_STORE_SECTOR_SIZE ? 0 : offset;
+}
+
+static uint32_t record_crc(const PubSubStoreRecord *rec, const uint8_t *payload){
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&rec->len, sizeof(rec->len));
+    crc = esp_rom_crc32_le(crc, (const uint8_t *)&rec->seq, sizeof(rec->seq));
+    return esp_rom_crc32_le(crc, payload, rec->len);
+}
+
+// Reads the header at offset and checks that a whole record of that length fits its sector.
+static bool read_header(PubSubStore *store, uint32_t offset, PubSubStoreRecord *rec){
+    uint32_t in_sector = offset % PUBSUB_STORE_SECTOR_SIZE;
+    if(in_sector + sizeof(PubSubStoreRecord) > PUBSUB_STORE_SECTOR_SIZE ||
+       esp_partition_read(store->partition, offset, rec, sizeof(PubSubStoreRecord)) != ESP_OK){
+        return false;
+    }
+    return rec->magic == PUBSUB_STORE_RECORD_MAGIC &&
+           in_sector + STORE_RECORD_SIZE(rec->len) <= PUBSUB_STORE_SECTOR_SIZE;
+}
+
+static bool read_payload(PubSubStore *store, uint32_t offset, const PubSubStoreRecord *rec, uint8_t *payload){
+    if(rec->len > 0 && esp_partition_read(store->partition, offset + sizeof(PubSubStoreRecord),
+                                          payload, rec->len) != ESP_OK){
+        return false;
+    }
+    return record_crc(rec, payload) == rec->crc;
+}
+
+static bool is_blank(PubSubStore *store, uint32_t offset, uint32_t len){
+    uint32_t buf[16];
+    while(len > 0){
+        uint32_t n = len < sizeof(buf) ? len : sizeof(buf);
+        if(esp_partition_read(store->partition, offset, buf, n) != ESP_OK){
+            return false;
+        }
+        const uint8_t *bytes = (const uint8_t *)buf;
+        for(uint32_t i = 0; i < n; i++){
+            if(bytes[i] != 0xFF){
+                return false;
+            }
+        }
+        offset += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Forgets every unsent record of a sector, which must hold the tail.
+static void drop_sector(PubSubStore *store, uint32_t sector){
+    uint16_t lost = store->sector_records[sector];
+    if(lost == 0){
+        return;
+    }
+    ESP_LOGW(TAG, "Dropping %u unsent records from sector %lu", lost, (unsigned long)sector);
+    store->dropped += lost;
+    store->count -= lost;
+    store->sector_records[sector] = 0;
+    store->tail = store->count > 0 ? next_sector_start(store, sector * PUBSUB_STORE_SECTOR_SIZE) : store->head;
+}
+
+/*
+ * Scans the partition once. Pass one finds every record with a valid CRC,
+ * the newest record (head goes after it) and the newest sent mark. Pass two
+ * counts, per sector, the records newer than that mark and finds the oldest
+ * of them, which becomes the tail. A sector is read up to its first invalid
+ * record, the same rule the drain walk follows.
+ */
+static esp_err_t store_mount(PubSubStore *store){
+    uint8_t *scratch = (uint8_t *)memAlloc(PUBSUB_STORE_SECTOR_SIZE);
+    if(scratch == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+    bool have_records = false, have_mark = false;
+    uint32_t max_seq = 0, mark_seq = 0, head = 0;
+    PubSubStoreRecord rec;
+
+    for(uint32_t s = 0; s < store->sector_count; s++){
+        uint32_t offset = s * PUBSUB_STORE_SECTOR_SIZE;
+        uint32_t end = offset + PUBSUB_STORE_SECTOR_SIZE;
+        uint16_t valid = 0;
+        while(offset < end && read_header(store, offset, &rec) && read_payload(store, offset, &rec, scratch)){
+            if(!have_records || rec.seq > max_seq){
+                max_seq = rec.seq;
+                head = offset + STORE_RECORD_SIZE(rec.len);
+                have_records = true;
+            }
+            if(rec.state == STORE_STATE_SENT && (!have_mark || rec.seq > mark_seq)){
+                mark_seq = rec.seq;
+                have_mark = true;
+            }
+            offset += STORE_RECORD_SIZE(rec.len);
+            valid++;
+        }
+        store->sector_records[s] = valid;
+    }
+    memFree(scratch);
+
+    uint32_t min_live_seq = UINT32_MAX;
+    store->count = 0;
+    for(uint32_t s = 0; s < store->sector_count; s++){
+        uint32_t offset = s * PUBSUB_STORE_SECTOR_SIZE;
+        uint16_t valid = store->sector_records[s];
+        uint16_t live = 0;
+        for(uint16_t i = 0; i < valid && read_header(store, offset, &rec); i++){
+            if(!have_mark || rec.seq > mark_seq){
+                if(rec.seq < min_live_seq){
+                    min_live_seq = rec.seq;
+                    store->tail = offset;
+                }
+                live++;
+            }
+            offset += STORE_RECORD_SIZE(rec.len);
+        }
+        store->sector_records[s] = live;
+        store->count += live;
+    }
+
+    store->next_seq = have_records ? max_seq + 1 : 0;
+    store->head = wrap_offset(store, head);
+    // Never append over the leftovers of an interrupted write.
+    uint32_t in_sector = store->head % PUBSUB_STORE_SECTOR_SIZE;
+    if(in_sector != 0 && !is_blank(store, store->head, PUBSUB_STORE_SECTOR_SIZE - in_sector)){
+        store->head = next_sector_start(store, store->head);
+    }
+    if(store->count == 0){
+        store->tail = store->head;
+    }
+    return ESP_OK;
+}
+
+PubSubStoreConfig default_PubSubStoreConfig(){
+    PubSubStoreConfig config = {
+        .partition_label = CONFIG_PUBSUB_STORE_PARTITION_LABEL,
+        .max_record_size = CONFIG_PUBSUB_STORE_MAX_RECORD_SIZE,
+        .max_attributes = CONFIG_PUBSUB_STORE_MAX_ATTRIBUTES,
+        .drain_max_messages = CONFIG_PUBSUB_STORE_DRAIN_MAX_MESSAGES,
+        .drain_max_bytes = CONFIG_PUBSUB_STORE_DRAIN_MAX_BYTES,
+        .drain_interval_ms = CONFIG_PUBSUB_STORE_DRAIN_INTERVAL_MS,
+        .retry_interval_ms = CONFIG_PUBSUB_STORE_RETRY_INTERVAL_MS,
+    };
+    return config;
+}
+
+PubSubStore *new_PubSubStore(const PubSubStoreConfig *config){
+    PubSubStore *store = (PubSubStore *)memCalloc(1, sizeof(PubSubStore));
+    if(store == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory for PubSubStore");
+        return NULL;
+    }
+    store->config = config ? *config : default_PubSubStoreConfig();
+    PubSubStoreConfig *cfg = &store->config;
+    if(cfg->max_record_size > PUBSUB_STORE_SECTOR_SIZE - sizeof(PubSubStoreRecord)){
+        cfg->max_record_size = PUBSUB_STORE_SECTOR_SIZE - sizeof(PubSubStoreRecord);
+    }
+    if(cfg->drain_max_messages == 0){
+        cfg->drain_max_messages = 1;
+    }
+    if(cfg->max_attributes > UINT8_MAX){
+        cfg->max_attributes = UINT8_MAX;
+    }
+    if(cfg->drain_max_bytes < cfg->max_record_size){
+        cfg->drain_max_bytes = cfg->max_record_size;
+    }
+
+    store->partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, cfg->partition_label);
+    if(store->partition == NULL){
+        ESP_LOGE(TAG, "Partition \"%s\" not found", cfg->partition_label);
+        goto error;
+    }
+    store->sector_count = store->partition->size / PUBSUB_STORE_SECTOR_SIZE;
+    if(store->sector_count < 2){
+        ESP_LOGE(TAG, "Partition \"%s\" needs at least two sectors", cfg->partition_label);
+        goto error;
+    }
+
+    store->sector_records = (uint16_t *)memCalloc(store->sector_count, sizeof(uint16_t));
+    store->drain_arena = (char *)memAlloc(cfg->drain_max_bytes);
+    store->drain_messages = (PushMessage *)memCalloc(cfg->drain_max_messages, sizeof(PushMessage));
+    store->drain_ptrs = (PushMessage **)memCalloc(cfg->drain_max_messages, sizeof(PushMessage *));
+    store->drain_offsets = (uint32_t *)memCalloc(cfg->drain_max_messages, sizeof(uint32_t));
+    store->drain_attributes = (PubSubAttribute *)memCalloc(cfg->max_attributes > 0 ? cfg->max_attributes : 1, sizeof(PubSubAttribute));
+    if(store->sector_records == NULL || store->drain_arena == NULL || store->drain_messages == NULL ||
+       store->drain_ptrs == NULL || store->drain_offsets == NULL || store->drain_attributes == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory for store index");
+        goto error;
+    }
+    for(uint32_t i = 0; i < cfg->drain_max_messages; i++){
+        store->drain_ptrs[i] = &store->drain_messages[i];
+    }
+
+    if(store_mount(store) != ESP_OK){
+        goto error;
+    }
+    ESP_LOGI(TAG, "Opened \"%s\": %lu sectors, %lu unsent records", cfg->partition_label,
+             (unsigned long)store->sector_count, (unsigned long)store->count);
+    return store;
+
+    error:
+    delete_PubSubStore(store);
+    return NULL;
+}
+
+void delete_PubSubStore(PubSubStore *store){
+    if(store == NULL){
+        return;
+    }
+    memFree(store->sector_records);
+    memFree(store->drain_arena);
+    memFree(store->drain_messages);
+    memFree(store->drain_ptrs);
+    memFree(store->drain_offsets);
+    memFree(store->drain_attributes);
+    memFree(store);
+}
+
+/*
+ * Lays a message out as a record payload in the drain arena, which is idle
+ * between drains and at least max_record_size long. Returns the length, or
+ * 0 if it does not fit a record.
+ */
+static size_t store_serialize(PubSubStore *store, const PushMessage *myMsg){
+    size_t data_len;
+    const uint8_t *data = pushMessagePayload(myMsg, &data_len);
+    size_t len = 1 + data_len;
+    for(size_t i = 0; i < myMsg->attribute_count; i++){
+        len += strlen(myMsg->attributes[i].key) + strlen(myMsg->attributes[i].value) + 2;
+    }
+    if(myMsg->attribute_count > store->config.max_attributes || len > store->config.max_record_size){
+        ESP_LOGE(TAG, "Record of %u bytes and %u attributes exceeds the store limits", (unsigned)len,
+                 (unsigned)myMsg->attribute_count);
+        return 0;
+    }
+    char *p = store->drain_arena;
+    *p++ = (char)myMsg->attribute_count;
+    for(size_t i = 0; i < myMsg->attribute_count; i++){
+        size_t key_len = strlen(myMsg->attributes[i].key) + 1;
+        size_t value_len = strlen(myMsg->attributes[i].value) + 1;
+        memcpy(p, myMsg->attributes[i].key, key_len);
+        memcpy(p + key_len, myMsg->attributes[i].value, value_len);
+        p += key_len + value_len;
+    }
+    if(data_len > 0){
+        memcpy(p, data, data_len);
+    }
+    return len;
+}
+
+/*
+ * Turns a record payload read into the drain arena back into a message
+ * that points into it. Attributes come from the shared table starting at
+ * *attribute_used; false if the table is full or the payload is malformed.
+ */
+static bool store_parse(PubSubStore *store, char *payload, size_t len, PushMessage *myMsg, uint32_t *attribute_used){
+    const char *end = payload + len;
+    uint32_t count = (uint8_t)payload[0];
+    if(len == 0 || *attribute_used + count > store->config.max_attributes){
+        return false;
+    }
+    PubSubAttribute *attributes = &store->drain_attributes[*attribute_used];
+    char *p = payload + 1;
+    for(uint32_t i = 0; i < count; i++){
+        const char *key = p;
+        const char *key_end = memchr(key, '\0', end - key);
+        const char *value_end = key_end != NULL ? memchr(key_end + 1, '\0', end - key_end - 1) : NULL;
+        if(value_end == NULL){
+            return false;
+        }
+        attributes[i].key = key;
+        attributes[i].value = key_end + 1;
+        p = (char *)value_end + 1;
+    }
+    memset(myMsg, 0, sizeof(PushMessage));
+    myMsg->data = (const uint8_t *)p;
+    myMsg->data_len = end - p;
+    myMsg->attributes = count > 0 ? attributes : NULL;
+    myMsg->attribute_count = count;
+    *attribute_used += count;
+    return true;
+}
+
+esp_err_t storeAppend(PubSubStore *store, const PushMessage *myMsg){
+    if(store == NULL || myMsg == NULL || (myMsg->attribute_count > 0 && myMsg->attributes == NULL)){
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t len = store_serialize(store, myMsg);
+    if(len == 0){
+        return ESP_ERR_INVALID_SIZE;
+    }
+    const char *data = store->drain_arena;
+    uint32_t size = STORE_RECORD_SIZE(len);
+    uint32_t in_sector = store->head % PUBSUB_STORE_SECTOR_SIZE;
+    if(in_sector != 0 && in_sector + size > PUBSUB_STORE_SECTOR_SIZE){
+        store->head = next_sector_start(store, store->head);
+        in_sector = 0;
+    }
+    uint32_t sector = sector_of(store->head);
+    if(in_sector == 0){
+        // Entering a sector: it holds the oldest data, so it is the one to recycle.
+        drop_sector(store, sector);
+        esp_err_t err = esp_partition_erase_range(store->partition, store->head, PUBSUB_STORE_SECTOR_SIZE);
+        if(err != ESP_OK){
+            ESP_LOGE(TAG, "Sector erase failed: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    PubSubStoreRecord rec = {
+        .magic = PUBSUB_STORE_RECORD_MAGIC,
+        .len = (uint16_t)len,
+        .seq = store->next_seq,
+        .state = STORE_STATE_OPEN,
+    };
+    rec.crc = record_crc(&rec, (const uint8_t *)data);
+    esp_err_t err = ESP_OK;
+    if(len > 0){
+        err = esp_partition_write(store->partition, store->head + sizeof(rec), data, len);
+    }
+    if(err == ESP_OK){
+        err = esp_partition_write(store->partition, store->head, &rec, sizeof(rec));
+    }
+    if(err != ESP_OK){
+        // Whatever was written is never reused: the next append starts a new sector.
+        ESP_LOGE(TAG, "Record write failed: %s", esp_err_to_name(err));
+        store->head = next_sector_start(store, store->head);
+        return err;
+    }
+
+    if(store->count == 0){
+        store->tail = store->head;
+    }
+    store->count++;
+    store->sector_records[sector]++;
+    store->head = wrap_offset(store, store->head + size);
+    store->next_seq++;
+    store->stored++;
+    return ESP_OK;
+}
+
+// Marks the first n records as sent with one flash write and moves the tail past them.
+static void store_commit(PubSubStore *store, uint32_t n, uint32_t next){
+    uint32_t last = store->drain_offsets[n - 1];
+    uint32_t sent = STORE_STATE_SENT;
+    esp_err_t err = esp_partition_write(store->partition, last + offsetof(PubSubStoreRecord, state), &sent, sizeof(sent));
+    if(err != ESP_OK){
+        // Only costs duplicates: the records are sent again after a reboot.
+        ESP_LOGW(TAG, "Failed to mark records as sent: %s", esp_err_to_name(err));
+    }
+    for(uint32_t i = 0; i < n; i++){
+        store->sector_records[sector_of(store->drain_offsets[i])]--;
+    }
+    store->count -= n;
+    store->tail = store->count > 0 ? next : store->head;
+}
+
+/*
+ * The flash no longer matches the index at offset: the unsent records of
+ * that sector, and of the tail sector if it is another one, are given up
+ * and the tail moves on to the next sector. Returns false once nothing is
+ * left to read, resetting the index if the counts no longer add up.
+ */
+static bool skip_corrupt(PubSubStore *store, uint32_t offset){
+    uint32_t sector = sector_of(offset);
+    uint32_t tail_sector = sector_of(store->tail);
+    uint32_t lost = store->sector_records[sector];
+    store->sector_records[sector] = 0;
+    if(tail_sector != sector){
+        lost += store->sector_records[tail_sector];
+        store->sector_records[tail_sector] = 0;
+    }
+    ESP_LOGE(TAG, "Corrupt record at 0x%lx, dropping %lu records", (unsigned long)offset, (unsigned long)lost);
+    lost = lost < store->count ? lost : store->count;
+    store->dropped += lost;
+    store->count -= lost;
+    store->tail = next_sector_start(store, offset);
+    if(store->count > 0 && sector_of(store->tail) == sector_of(store->head) && store->sector_records[sector_of(store->head)] == 0){
+        ESP_LOGE(TAG, "Store index out of sync, discarding %lu records", (unsigned long)store->count);
+        memset(store->sector_records, 0, store->sector_count * sizeof(uint16_t));
+        store->dropped += store->count;
+        store->count = 0;
+    }
+    if(store->count == 0){
+        store->tail = store->head;
+        return false;
+    }
+    return true;
+}
+
+// Gathers up to drain_max_messages records from the tail into the drain arena.
+static uint32_t store_gather(PubSubStore *store, uint32_t *next){
+    PubSubStoreConfig *cfg = &store->config;
+    uint32_t offset = store->tail;
+    uint32_t n = 0, attribute_used = 0;
+    size_t used = 0;
+    PubSubStoreRecord rec;
+
+    while(n < cfg->drain_max_messages && n < store->count){
+        bool ok = read_header(store, offset, &rec);
+        if(!ok && offset % PUBSUB_STORE_SECTOR_SIZE != 0){
+            // Nothing more in this sector, the walk continues in the next one.
+            offset = next_sector_start(store, offset);
+            ok = read_header(store, offset, &rec);
+        }
+        if(ok && used + rec.len > cfg->drain_max_bytes){
+            break;
+        }
+        if(ok){
+            ok = read_payload(store, offset, &rec, (uint8_t *)store->drain_arena + used);
+        }
+        if(ok){
+            // After the first record a failure is usually just a full attribute table.
+            ok = store_parse(store, store->drain_arena + used, rec.len, &store->drain_messages[n], &attribute_used);
+        }
+        if(!ok){
+            if(n > 0){
+                break;
+            }
+            if(!skip_corrupt(store, offset)){
+                break;
+            }
+            offset = store->tail;
+            continue;
+        }
+        store->drain_offsets[n] = offset;
+        used += rec.len;
+        offset = wrap_offset(store, offset + STORE_RECORD_SIZE(rec.len));
+        n++;
+    }
+    *next = offset;
+    return n;
+}
+
+esp_err_t storeDrain(PubSubStore *store, PubSubClient *client, PubSubTopic *Topic){
+    if(store == NULL || client == NULL || Topic == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t now = esp_timer_get_time();
+    if(store->count == 0 || now < store->next_drain_time){
+        return ESP_OK;
+    }
+    uint32_t next;
+    uint32_t n = store_gather(store, &next);
+    if(n == 0){
+        return ESP_OK;
+    }
+
+    esp_err_t err = clientPostMessages(client, store->drain_ptrs, n, Topic);
+    uint32_t posted = 0;
+    for(uint32_t i = 0; i < n; i++){
+        posted += store->drain_messages[i].posted_ok;
+        memFree(store->drain_messages[i].message_id);
+        store->drain_messages[i].message_id = NULL;
+    }
+
+    if(err != ESP_OK && err != ESP_ERR_INVALID_RESPONSE){
+        // Offline, or Pub/Sub asked to retry (ESP_ERR_HTTP_EAGAIN): keep everything for later.
+        ESP_LOGW(TAG, "Drain of %lu records failed: %s", (unsigned long)n, esp_err_to_name(err));
+        store->next_drain_time = now + (int64_t)store->config.retry_interval_ms * 1000;
+        return err;
+    }
+    if(posted < n){
+        // Pub/Sub answered but rejected them; retrying would block the queue for good.
+        ESP_LOGW(TAG, "Pub/Sub rejected %lu stored records", (unsigned long)(n - posted));
+        store->rejected += n - posted;
+    }
+    store_commit(store, n, next);
+    store->drained += posted;
+    store->next_drain_time = now + (int64_t)store->config.drain_interval_ms * 1000;
+    ESP_LOGI(TAG, "Drained %lu records, %lu left", (unsigned long)posted, (unsigned long)store->count);
+    return err;
+}
+
+uint32_t storeTimeToDrainMs(PubSubStore *store){
+    if(store == NULL || store->count == 0){
+        return UINT32_MAX;
+    }
+    int64_t wait_us = store->next_drain_time - esp_timer_get_time();
+    return wait_us > 0 ? (uint32_t)(wait_us / 1000) : 0;
+}
@@ -0,0 +1,108 @@
+/**
+ * PubSubStore.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef PUBSUB_STORE_H
+#define PUBSUB_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "PubSub.h"
+
+#define PUBSUB_STORE_SECTOR_SIZE 4096
+#define PUBSUB_STORE_RECORD_MAGIC 0x5054
+
+typedef struct{
+    const char *partition_label;
+    size_t max_record_size;
+    uint32_t max_attributes;
+    uint32_t drain_max_messages;
+    size_t drain_max_bytes;
+    uint32_t drain_interval_ms;
+    uint32_t retry_interval_ms;
+}PubSubStoreConfig;
+
+/*
+ * Record header in flash. The payload follows, padded to 4 bytes: an
+ * attribute count byte, that many key/value pairs as NUL-terminated
+ * strings, then the message data. The CRC
+ * covers len, seq and the payload, and the header is written after the
+ * payload, so a torn append never looks valid. state is programmed to 0 on
+ * the last record of each published batch, which marks it and everything
+ * older as sent without erasing anything.
+ */
+typedef struct{
+    uint16_t magic;
+    uint16_t len;
+    uint32_t seq;
+    uint32_t crc;
+    uint32_t state;
+}PubSubStoreRecord;
+
+/*
+ * Persistent outbound queue in a data partition, used as a ring of 4 KiB
+ * sectors. Records are appended at head and never span a sector; a sector
+ * is erased only when head wraps around into it, so each sector is erased
+ * once per lap. If head catches up with the oldest unsent sector, that
+ * sector's records are dropped. Head, tail and the live record count of
+ * every sector are kept in RAM, so append and drain never scan the flash;
+ * the partition is scanned once when the store is opened. Not thread-safe:
+ * one task, normally the publisher, owns the store.
+ */
+typedef struct PubSubStore{
+    const esp_partition_t *partition;
+    PubSubStoreConfig config;
+    uint32_t sector_count;
+    uint16_t *sector_records;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t count;
+    uint32_t next_seq;
+    int64_t next_drain_time;
+    char *drain_arena;
+    PushMessage *drain_messages;
+    PushMessage **drain_ptrs;
+    PubSubAttribute *drain_attributes;
+    uint32_t *drain_offsets;
+    uint32_t stored;
+    uint32_t drained;
+    uint32_t dropped;
+    uint32_t rejected;
+}PubSubStore;
+
+PubSubStoreConfig default_PubSubStoreConfig();
+PubSubStore *new_PubSubStore(const PubSubStoreConfig *config);
+void delete_PubSubStore(PubSubStore *store);
+esp_err_t storeAppend(PubSubStore *store, const PushMessage *myMsg);
+esp_err_t storeDrain(PubSubStore *store, PubSubClient *client, PubSubTopic *Topic);
+uint32_t storeTimeToDrainMs(PubSubStore *store);
+
+static inline uint32_t storeCount(const PubSubStore *store){
+    return store != NULL ? store->count : 0;
+}
+
+#endif // PUBSUB_STORE_H
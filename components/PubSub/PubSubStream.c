@@ -0,0 +1,182 @@
+/**
+ * PubSubStream.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "PubSubStream.h"
+#include "mem_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+
+static const char *TAG = "PubSubStream";
+static const char received_messages_key[] = "receivedMessages";
+
+void pullStreamInit(PullStreamParser *parser, size_t max_element_size, pull_element_callback_t on_element, void *ctx){
+    memset(parser, 0, sizeof(PullStreamParser));
+    parser->max_element_size = max_element_size;
+    parser->on_element = on_element;
+    parser->ctx = ctx;
+}
+
+// Keeps the element buffer so the next response can reuse it.
+void pullStreamReset(PullStreamParser *parser){
+    parser->depth = 0;
+    parser->in_string = false;
+    parser->escape = false;
+    parser->in_messages = false;
+    parser->capturing = false;
+    parser->key_len = 0;
+    parser->element_len = 0;
+    parser->element_start = NULL;
+    parser->element_overflow = false;
+    parser->elements = 0;
+    parser->skipped = 0;
+}
+
+void pullStreamFree(PullStreamParser *parser){
+    memFree(parser->element);
+    parser->element = NULL;
+    parser->element_size = 0;
+    pullStreamReset(parser);
+}
+
+static bool append_element(PullStreamParser *parser, char c){
+    if(parser->max_element_size == 0){
+        return true;
+    }
+    if(parser->element_overflow){
+        return false;
+    }
+    if(parser->element_len + 2 > parser->element_size){
+        size_t new_size = parser->element_size ? parser->element_size * 2 : 512;
+        if(new_size > parser->max_element_size){
+            new_size = parser->max_element_size;
+        }
+        if(new_size < parser->element_len + 2){
+            ESP_LOGE(TAG, "Message larger than %u bytes, skipping it", (unsigned)parser->max_element_size);
+            parser->element_overflow = true;
+            return false;
+        }
+        char *temp = (char *)memRealloc(parser->element, new_size);
+        if(temp == NULL){
+            ESP_LOGE(TAG, "Failed to allocate memory for message");
+            parser->element_overflow = true;
+            return false;
+        }
+        parser->element = temp;
+        parser->element_size = new_size;
+    }
+    parser->element[parser->element_len++] = c;
+    return true;
+}
+
+static void element_finished(PullStreamParser *parser, const char *end){
+    parser->capturing = false;
+    if(parser->max_element_size == 0){
+        parser->elements++;
+        if(parser->on_element != NULL){
+            // Zero-copy: the element lives in the caller's buffer.
+            parser->on_element((char *)parser->element_start, end - parser->element_start + 1, parser->ctx);
+        }
+        return;
+    }
+    if(parser->element_overflow){
+        parser->skipped++;
+        parser->element_overflow = false;
+        return;
+    }
+    parser->element[parser->element_len] = '\0';
+    parser->elements++;
+    if(parser->on_element != NULL){
+        parser->on_element(parser->element, parser->element_len, parser->ctx);
+    }
+}
+
+esp_err_t pullStreamFeed(PullStreamParser *parser, const char *data, size_t len){
+    if(parser == NULL || data == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    for(size_t i = 0; i < len; i++){
+        char c = data[i];
+
+        if(parser->capturing){
+            append_element(parser, c);
+        }
+
+        if(parser->in_string){
+            if(parser->escape){
+                parser->escape = false;
+            }else if(c == '\\'){
+                parser->escape = true;
+            }else if(c == '"'){
+                parser->in_string = false;
+            }else if(parser->depth == 1 && parser->key_len < sizeof(parser->key)){
+                parser->key[parser->key_len++] = c;
+            }
+            continue;
+        }
+
+        switch(c){
+            case '"':
+                parser->in_string = true;
+                if(parser->depth == 1){
+                    parser->key_len = 0;
+                }
+                break;
+            case '{':
+            case '[':
+                if(c == '{' && parser->in_messages && parser->depth == 2){
+                    parser->capturing = true;
+                    parser->element_len = 0;
+                    parser->element_overflow = false;
+                    parser->element_start = &data[i];
+                    append_element(parser, c);
+                }
+                if(c == '[' && parser->depth == 1 && parser->key_len == strlen(received_messages_key) &&
+                   memcmp(parser->key, received_messages_key, parser->key_len) == 0){
+                    parser->in_messages = true;
+                }
+                parser->depth++;
+                break;
+            case '}':
+            case ']':
+                parser->depth--;
+                if(parser->capturing && parser->depth == 2){
+                    element_finished(parser, &data[i]);
+                }
+                if(parser->in_messages && parser->depth == 1){
+                    parser->in_messages = false;
+                }
+                if(parser->depth < 0){
+                    ESP_LOGE(TAG, "Malformed pull response");
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return ESP_OK;
+}
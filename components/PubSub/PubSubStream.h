@@ -0,0 +1,74 @@
+/**
+ * PubSubStream.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef PUBSUB_STREAM_H
+#define PUBSUB_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define PULL_STREAM_KEY_SIZE 24
+
+typedef void (*pull_element_callback_t)(char *json, size_t len, void *ctx);
+
+/*
+ * Incremental tokenizer for :pull responses. Body chunks are fed as they
+ * arrive and every element of the top level "receivedMessages" array is
+ * handed to on_element as soon as its closing brace is seen, so only one
+ * message has to be held in RAM at a time.
+ *
+ * With max_element_size set to 0 the parser runs zero-copy: the whole body
+ * must be fed in one call and on_element gets a pointer into that buffer,
+ * which the callback may modify in place.
+ */
+typedef struct PullStreamParser{
+    int depth;
+    bool in_string;
+    bool escape;
+    bool in_messages;
+    bool capturing;
+    char key[PULL_STREAM_KEY_SIZE];
+    size_t key_len;
+    char *element;
+    const char *element_start;
+    size_t element_len;
+    size_t element_size;
+    size_t max_element_size;
+    bool element_overflow;
+    uint32_t elements;
+    uint32_t skipped;
+    pull_element_callback_t on_element;
+    void *ctx;
+}PullStreamParser;
+
+void pullStreamInit(PullStreamParser *parser, size_t max_element_size, pull_element_callback_t on_element, void *ctx);
+void pullStreamReset(PullStreamParser *parser);
+void pullStreamFree(PullStreamParser *parser);
+esp_err_t pullStreamFeed(PullStreamParser *parser, const char *data, size_t len);
+
+#endif // PUBSUB_STREAM_H
@@ -0,0 +1,341 @@
+/**
+ * PubSubSubscriber.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "PubSubSubscriber.h"
+#include "mem_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "PubSubSubscriber";
+
+static uint32_t next_backoff(PubSubSubscriber *subscriber){
+    if(subscriber->backoff_ms == 0){
+        return subscriber->config.min_backoff_ms;
+    }
+    uint32_t backoff = subscriber->backoff_ms * 2;
+    return backoff > subscriber->config.max_backoff_ms ? subscriber->config.max_backoff_ms : backoff;
+}
+
+static SubscriberBatch *find_batch(PubSubSubscriber *subscriber, const char *arena){
+    for(uint32_t i = 0; i < subscriber->batch_slots; i++){
+        if(subscriber->batches[i].pull.arena == arena && arena != NULL){
+            return &subscriber->batches[i];
+        }
+    }
+    return NULL;
+}
+
+static void release_message(PubSubSubscriber *subscriber, const char *arena, const Message *msg){
+    SubscriberBatch *batch = find_batch(subscriber, arena);
+    if(batch == NULL || batch->pending == 0){
+        ESP_LOGE(TAG, "Release of unknown message");
+        return;
+    }
+    if(subscriber->acker != NULL){
+        ackerAdd(subscriber->acker, messageAckId(arena, msg));
+    }
+    batch->pending--;
+    subscriber->outstanding_messages--;
+    if(batch->pending == 0){
+        subscriber->outstanding_bytes -= batch->pull.arena_size;
+        freePullMessages(&batch->pull);
+    }
+}
+
+static SubscriberBatch *find_batch_slot_free(PubSubSubscriber *subscriber){
+    for(uint32_t i = 0; i < subscriber->batch_slots; i++){
+        if(subscriber->batches[i].pull.arena == NULL){
+            return &subscriber->batches[i];
+        }
+    }
+    return NULL;
+}
+
+// Handles one event from the release queue; returns false for the stop request.
+static bool handle_release(PubSubSubscriber *subscriber, SubscriberRelease *release){
+    if(release->arena == NULL){
+        return false;
+    }
+    release_message(subscriber, release->arena, release->msg);
+    return true;
+}
+
+/*
+ * Waits up to wait_ms for released messages, flushing acks on time. Returns
+ * early once something was released so the caller can pull again.
+ */
+static void wait_for_releases(PubSubSubscriber *subscriber, uint32_t wait_ms){
+    SubscriberRelease release;
+    while(subscriber->running){
+        uint32_t wait = wait_ms;
+        uint32_t ack_wait = ackerTimeToFlushMs(subscriber->acker);
+        if(ack_wait < wait){
+            wait = ack_wait;
+        }
+        TickType_t ticks = wait == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait);
+        if(xQueueReceive(subscriber->releases, &release, ticks) == pdTRUE){
+            if(!handle_release(subscriber, &release)){
+                subscriber->running = false;
+                return;
+            }
+            while(xQueueReceive(subscriber->releases, &release, 0) == pdTRUE){
+                if(!handle_release(subscriber, &release)){
+                    subscriber->running = false;
+                    return;
+                }
+            }
+            ackerFlushIfDue(subscriber->acker);
+            return;
+        }
+        ackerFlushIfDue(subscriber->acker);
+        if(wait_ms != UINT32_MAX){
+            wait_ms -= wait;
+            if(wait_ms == 0){
+                return;
+            }
+        }
+    }
+}
+
+static void drain_releases(PubSubSubscriber *subscriber){
+    SubscriberRelease release;
+    while(xQueueReceive(subscriber->releases, &release, 0) == pdTRUE){
+        if(!handle_release(subscriber, &release)){
+            subscriber->running = false;
+        }
+    }
+}
+
+// Number of messages the next pull may ask for, 0 while the limits are reached.
+static uint32_t pull_capacity(PubSubSubscriber *subscriber){
+    if(subscriber->outstanding_messages >= subscriber->config.max_outstanding_messages ||
+       subscriber->outstanding_bytes >= subscriber->config.max_outstanding_bytes ||
+       find_batch_slot_free(subscriber) == NULL){
+        return 0;
+    }
+    uint32_t capacity = subscriber->config.max_outstanding_messages - subscriber->outstanding_messages;
+    size_t by_bytes = (subscriber->config.max_outstanding_bytes - subscriber->outstanding_bytes) / subscriber->avg_message_bytes;
+    if(by_bytes == 0){
+        // Always allow one message while nothing is outstanding, or a large
+        // message could never be pulled.
+        return subscriber->outstanding_messages == 0 ? 1 : 0;
+    }
+    if(by_bytes < capacity){
+        capacity = by_bytes;
+    }
+    if(subscriber->config.max_messages < capacity){
+        capacity = subscriber->config.max_messages;
+    }
+    return capacity;
+}
+
+static void deliver_messages(PubSubSubscriber *subscriber, SubscriberBatch *batch){
+    PullMessage *myMsg = &batch->pull;
+    batch->pending = myMsg->msg_count;
+    subscriber->outstanding_messages += myMsg->msg_count;
+    subscriber->outstanding_bytes += myMsg->arena_size;
+    subscriber->received += myMsg->msg_count;
+
+    // Running estimate of the RAM one message costs, used to size pulls.
+    size_t sample = myMsg->arena_size / myMsg->msg_count;
+    subscriber->avg_message_bytes = (subscriber->avg_message_bytes * 3 + sample) / 4;
+    if(subscriber->avg_message_bytes == 0){
+        subscriber->avg_message_bytes = 1;
+    }
+
+    int count = myMsg->msg_count;
+    char *arena = myMsg->arena;
+    Message *messages = myMsg->message_array;
+    for(int i = 0; i < count; i++){
+        if(subscriber->config.callback != NULL){
+            subscriber->config.callback(arena, &messages[i], subscriber->config.callback_ctx);
+        }
+        if(!subscriber->config.manual_release){
+            release_message(subscriber, arena, &messages[i]);
+        }
+    }
+}
+
+static void subscriber_task(void *arg){
+    PubSubSubscriber *subscriber = (PubSubSubscriber *)arg;
+
+    while(subscriber->running){
+        drain_releases(subscriber);
+        uint32_t capacity = pull_capacity(subscriber);
+        if(capacity == 0){
+            subscriber->flow_pauses++;
+            ESP_LOGD(TAG, "Flow control: %lu messages, %u bytes outstanding", (unsigned long)subscriber->outstanding_messages,
+                     (unsigned)subscriber->outstanding_bytes);
+            wait_for_releases(subscriber, UINT32_MAX);
+            continue;
+        }
+
+        SubscriberBatch *batch = find_batch_slot_free(subscriber);
+        memset(&batch->pull, 0, sizeof(PullMessage));
+        clientPullMessagesMax(subscriber->client, &batch->pull, subscriber->topic, capacity);
+        subscriber->pulls++;
+
+        if(batch->pull.received_ok && batch->pull.msg_count > 0){
+            deliver_messages(subscriber, batch);
+            ackerFlushIfDue(subscriber->acker);
+            // Backlog is not empty, pull again without waiting.
+            subscriber->backoff_ms = 0;
+            continue;
+        }
+        if(batch->pull.received_ok){
+            subscriber->empty_pulls++;
+        }
+        freePullMessages(&batch->pull);
+
+        subscriber->backoff_ms = next_backoff(subscriber);
+        ESP_LOGD(TAG, "No messages, next pull in %lu ms", (unsigned long)subscriber->backoff_ms);
+        wait_for_releases(subscriber, subscriber->backoff_ms);
+    }
+
+    ackerFlush(subscriber->acker);
+    xTaskNotifyGive(subscriber->stop_waiter);
+    vTaskDelete(NULL);
+}
+
+PubSubSubscriberConfig default_PubSubSubscriberConfig(){
+    PubSubSubscriberConfig config = {
+        .max_messages = CONFIG_PUBSUB_SUBSCRIBER_MAX_MESSAGES,
+        .min_backoff_ms = CONFIG_PUBSUB_SUBSCRIBER_MIN_BACKOFF_MS,
+        .max_backoff_ms = CONFIG_PUBSUB_SUBSCRIBER_MAX_BACKOFF_MS,
+        .max_outstanding_messages = CONFIG_PUBSUB_SUBSCRIBER_MAX_OUTSTANDING_MESSAGES,
+        .max_outstanding_bytes = CONFIG_PUBSUB_SUBSCRIBER_MAX_OUTSTANDING_BYTES,
+        .auto_ack = true,
+        .task_stack_size = CONFIG_PUBSUB_SUBSCRIBER_TASK_STACK_SIZE,
+        .task_priority = CONFIG_PUBSUB_SUBSCRIBER_TASK_PRIORITY,
+        .task_core = tskNO_AFFINITY,
+    };
+    return config;
+}
+
+PubSubSubscriber *new_PubSubSubscriber(PubSubClient *client, PubSubTopic *Topic, const PubSubSubscriberConfig *config){
+    if(client == NULL || Topic == NULL){
+        return NULL;
+    }
+    PubSubSubscriber *subscriber = (PubSubSubscriber *)memCalloc(1, sizeof(PubSubSubscriber));
+    if(subscriber == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory for PubSubSubscriber");
+        return NULL;
+    }
+    subscriber->client = client;
+    subscriber->topic = Topic;
+    subscriber->config = config ? *config : default_PubSubSubscriberConfig();
+    if(subscriber->config.max_messages == 0){
+        subscriber->config.max_messages = PUBSUB_PULL_MAX_MESSAGES;
+    }
+    if(subscriber->config.min_backoff_ms == 0){
+        subscriber->config.min_backoff_ms = 1;
+    }
+    if(subscriber->config.max_backoff_ms < subscriber->config.min_backoff_ms){
+        subscriber->config.max_backoff_ms = subscriber->config.min_backoff_ms;
+    }
+    if(subscriber->config.max_outstanding_messages == 0){
+        subscriber->config.max_outstanding_messages = UINT32_MAX;
+    }
+    if(subscriber->config.max_outstanding_bytes == 0){
+        subscriber->config.max_outstanding_bytes = SIZE_MAX;
+    }
+    subscriber->avg_message_bytes = CONFIG_PUBSUB_SUBSCRIBER_INITIAL_MESSAGE_BYTES;
+
+    subscriber->batch_slots = CONFIG_PUBSUB_SUBSCRIBER_MAX_BATCHES;
+    subscriber->batches = (SubscriberBatch *)memCalloc(subscriber->batch_slots, sizeof(SubscriberBatch));
+    uint32_t queue_length = subscriber->config.max_outstanding_messages < CONFIG_PUBSUB_SUBSCRIBER_RELEASE_QUEUE_LENGTH ?
+                            subscriber->config.max_outstanding_messages : CONFIG_PUBSUB_SUBSCRIBER_RELEASE_QUEUE_LENGTH;
+    subscriber->releases = xQueueCreate(queue_length + 1, sizeof(SubscriberRelease));
+    if(subscriber->batches == NULL || subscriber->releases == NULL){
+        goto error;
+    }
+
+    if(subscriber->config.auto_ack){
+        subscriber->acker = new_PubSubAcker(client, Topic, subscriber->config.ack_max_ids, subscriber->config.ack_max_delay_ms);
+        if(subscriber->acker == NULL){
+            goto error;
+        }
+    }
+
+    subscriber->running = true;
+    if(xTaskCreatePinnedToCore(subscriber_task, "pubsub_sub", subscriber->config.task_stack_size, subscriber,
+                               subscriber->config.task_priority, &subscriber->task, subscriber->config.task_core) != pdPASS){
+        goto error;
+    }
+    return subscriber;
+
+    error:
+    ESP_LOGE(TAG, "Failed to start subscriber");
+    delete_PubSubAcker(subscriber->acker);
+    if(subscriber->releases != NULL){
+        vQueueDelete(subscriber->releases);
+    }
+    memFree(subscriber->batches);
+    memFree(subscriber);
+    return NULL;
+}
+
+void delete_PubSubSubscriber(PubSubSubscriber *subscriber){
+    if(subscriber == NULL){
+        return;
+    }
+    SubscriberRelease stop = {0};
+    subscriber->stop_waiter = xTaskGetCurrentTaskHandle();
+    xQueueSendToBack(subscriber->releases, &stop, portMAX_DELAY);
+    subscriber->running = false;
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    ESP_LOGI(TAG, "Subscriber stopped, pulls : %lu , empty : %lu , received : %lu , flow pauses : %lu",
+             (unsigned long)subscriber->pulls, (unsigned long)subscriber->empty_pulls,
+             (unsigned long)subscriber->received, (unsigned long)subscriber->flow_pauses);
+
+    // Messages still held by handlers are not acknowledged and will be redelivered.
+    for(uint32_t i = 0; i < subscriber->batch_slots; i++){
+        freePullMessages(&subscriber->batches[i].pull);
+    }
+    delete_PubSubAcker(subscriber->acker);
+    vQueueDelete(subscriber->releases);
+    memFree(subscriber->batches);
+    memFree(subscriber);
+}
+
+esp_err_t subscriberRelease(PubSubSubscriber *subscriber, const char *arena, const Message *msg){
+    if(subscriber == NULL || arena == NULL || msg == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    SubscriberRelease release = {
+        .arena = arena,
+        .msg = msg,
+    };
+    if(xTaskGetCurrentTaskHandle() == subscriber->task){
+        // Released from inside the callback.
+        release_message(subscriber, arena, msg);
+        return ESP_OK;
+    }
+    return xQueueSendToBack(subscriber->releases, &release, portMAX_DELAY) == pdTRUE ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,108 @@
+/**
+ * PubSubSubscriber.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef PUBSUB_SUBSCRIBER_H
+#define PUBSUB_SUBSCRIBER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "PubSub.h"
+#include "PubSubAck.h"
+
+typedef struct{
+    uint32_t max_messages;
+    uint32_t min_backoff_ms;
+    uint32_t max_backoff_ms;
+    uint32_t max_outstanding_messages;
+    size_t max_outstanding_bytes;
+    bool manual_release;
+    bool auto_ack;
+    uint32_t ack_max_ids;
+    uint32_t ack_max_delay_ms;
+    uint32_t task_stack_size;
+    UBaseType_t task_priority;
+    BaseType_t task_core;
+    pull_message_callback_t callback;
+    void *callback_ctx;
+}PubSubSubscriberConfig;
+
+typedef struct{
+    PullMessage pull;
+    uint32_t pending;
+}SubscriberBatch;
+
+typedef struct{
+    const char *arena;
+    const Message *msg;
+}SubscriberRelease;
+
+/*
+ * Continuous subscriber running in its own task. It pulls again right away
+ * while the subscription returns messages and doubles its idle wait from
+ * min_backoff_ms up to max_backoff_ms after every empty or failed pull.
+ *
+ * Flow control: a pulled batch stays outstanding until every message in it
+ * is released. Pulls are sized so the outstanding messages and bytes stay
+ * within the configured limits, and pulling pauses while they are reached.
+ * Without manual_release a message is released when the callback returns;
+ * with it the handler keeps the message and calls subscriberRelease() later,
+ * from any task. Releasing acknowledges the message when auto_ack is set.
+ * The byte limit is enforced against an estimate of the message size, so a
+ * single pull of unusually large messages can overshoot it.
+ *
+ * The PubSubClient must not be used by other tasks while it is running.
+ */
+typedef struct PubSubSubscriber{
+    PubSubClient *client;
+    PubSubTopic *topic;
+    PubSubSubscriberConfig config;
+    PubSubAcker *acker;
+    TaskHandle_t task;
+    TaskHandle_t stop_waiter;
+    QueueHandle_t releases;
+    SubscriberBatch *batches;
+    uint32_t batch_slots;
+    uint32_t outstanding_messages;
+    size_t outstanding_bytes;
+    size_t avg_message_bytes;
+    volatile bool running;
+    uint32_t backoff_ms;
+    uint32_t pulls;
+    uint32_t empty_pulls;
+    uint32_t received;
+    uint32_t flow_pauses;
+}PubSubSubscriber;
+
+PubSubSubscriberConfig default_PubSubSubscriberConfig();
+PubSubSubscriber *new_PubSubSubscriber(PubSubClient *client, PubSubTopic *Topic, const PubSubSubscriberConfig *config);
+void delete_PubSubSubscriber(PubSubSubscriber *subscriber);
+esp_err_t subscriberRelease(PubSubSubscriber *subscriber, const char *arena, const Message *msg);
+
+#endif // PUBSUB_SUBSCRIBER_H
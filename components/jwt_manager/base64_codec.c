@@ -0,0 +1,359 @@
+/**
+ * base64_codec.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "base64_codec.h"
+#include "mem_alloc.h"
+#include <string.h>
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "Base64";
+
+#define B64_INVALID 0xFF
+
+/*
+ * Encoding tables indexed by 12 bits of input, so one lookup yields two
+ * output characters and a 3-byte group takes two lookups. They are built
+ * by the preprocessor and live in flash.
+ */
+#define B64_CHAR(v, c62, c63) ((v) < 26 ? 'A' + (v) : (v) < 52 ? 'a' + (v) - 26 : \
+                               (v) < 62 ? '0' + (v) - 52 : (v) == 62 ? (c62) : (c63))
+#define B64_PAIR(i, c62, c63) {B64_CHAR((i) >> 6, c62, c63), B64_CHAR((i) & 0x3F, c62, c63)}
+#define B64_PAIRS_4(i, c62, c63) B64_PAIR(i, c62, c63), B64_PAIR((i) + 1, c62, c63), \
+                                 B64_PAIR((i) + 2, c62, c63), B64_PAIR((i) + 3, c62, c63)
+#define B64_PAIRS_16(i, c62, c63) B64_PAIRS_4(i, c62, c63), B64_PAIRS_4((i) + 4, c62, c63), \
+                                  B64_PAIRS_4((i) + 8, c62, c63), B64_PAIRS_4((i) + 12, c62, c63)
+#define B64_PAIRS_64(i, c62, c63) B64_PAIRS_16(i, c62, c63), B64_PAIRS_16((i) + 16, c62, c63), \
+                                  B64_PAIRS_16((i) + 32, c62, c63), B64_PAIRS_16((i) + 48, c62, c63)
+#define B64_PAIRS_256(i, c62, c63) B64_PAIRS_64(i, c62, c63), B64_PAIRS_64((i) + 64, c62, c63), \
+                                   B64_PAIRS_64((i) + 128, c62, c63), B64_PAIRS_64((i) + 192, c62, c63)
+#define B64_PAIRS_1024(i, c62, c63) B64_PAIRS_256(i, c62, c63), B64_PAIRS_256((i) + 256, c62, c63), \
+                                    B64_PAIRS_256((i) + 512, c62, c63), B64_PAIRS_256((i) + 768, c62, c63)
+#define B64_PAIRS_4096(c62, c63) B64_PAIRS_1024(0, c62, c63), B64_PAIRS_1024(1024, c62, c63), \
+                                 B64_PAIRS_1024(2048, c62, c63), B64_PAIRS_1024(3072, c62, c63)
+
+static const char base64PairsStandard[4096][2] = { B64_PAIRS_4096('+', '/') };
+static const char base64PairsUrl[4096][2] = { B64_PAIRS_4096('-', '_') };
+
+// Sextet value of every byte, for both alphabets at once.
+static const uint8_t base64Values[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0x3E, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0x3F,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,};
+
+static inline const char (*base64_pairs(base64_alphabet_t alphabet))[2]{
+    return alphabet == BASE64_URL ? base64PairsUrl : base64PairsStandard;
+}
+
+static char *encode_groups(char *out, const uint8_t *in, size_t groups, const char (*pairs)[2]){
+    while(groups-- > 0){
+        uint32_t word = ((uint32_t)in[0] << 16) | ((uint32_t)in[1] << 8) | in[2];
+        memcpy(out, pairs[word >> 12], 2);
+        memcpy(out + 2, pairs[word & 0xFFF], 2);
+        in += 3;
+        out += 4;
+    }
+    return out;
+}
+
+// Encodes the last one or two bytes.
+static char *encode_tail(char *out, const uint8_t *in, size_t len, const char (*pairs)[2], bool pad){
+    uint32_t word = (uint32_t)in[0] << 16;
+    if(len == 2){
+        word |= (uint32_t)in[1] << 8;
+    }
+    memcpy(out, pairs[word >> 12], 2);
+    out += 2;
+    if(len == 2){
+        *out++ = pairs[word & 0xFFF][0];
+    }else if(pad){
+        *out++ = '=';
+    }
+    if(pad){
+        *out++ = '=';
+    }
+    return out;
+}
+
+size_t base64Encode(char *out, size_t out_size, const uint8_t *in, size_t len, base64_alphabet_t alphabet, bool pad){
+    if(out == NULL || (in == NULL && len > 0) || out_size < BASE64_ENCODED_LEN(len, pad) + 1){
+        ESP_LOGE(TAG, "Encode buffer too small for %u bytes", (unsigned)len);
+        return 0;
+    }
+    const char (*pairs)[2] = base64_pairs(alphabet);
+    char *p = encode_groups(out, in, len / 3, pairs);
+    if(len % 3){
+        p = encode_tail(p, in + len - len % 3, len % 3, pairs, pad);
+    }
+    *p = '\0';
+    return p - out;
+}
+
+void base64EncoderInit(Base64Encoder *enc, base64_alphabet_t alphabet, bool pad){
+    memset(enc, 0, sizeof(Base64Encoder));
+    enc->alphabet = alphabet;
+    enc->pad = pad;
+}
+
+size_t base64EncoderUpdate(Base64Encoder *enc, char *out, const uint8_t *in, size_t len){
+    const char (*pairs)[2] = base64_pairs(enc->alphabet);
+    char *p = out;
+    if(enc->carry_len > 0){
+        uint8_t group[3];
+        size_t take = 3 - enc->carry_len;
+        if(len < take){
+            memcpy(enc->carry + enc->carry_len, in, len);
+            enc->carry_len += len;
+            return 0;
+        }
+        memcpy(group, enc->carry, enc->carry_len);
+        memcpy(group + enc->carry_len, in, take);
+        p = encode_groups(p, group, 1, pairs);
+        in += take;
+        len -= take;
+        enc->carry_len = 0;
+    }
+    p = encode_groups(p, in, len / 3, pairs);
+    enc->carry_len = len % 3;
+    memcpy(enc->carry, in + len - enc->carry_len, enc->carry_len);
+    return p - out;
+}
+
+size_t base64EncoderFinish(Base64Encoder *enc, char *out){
+    if(enc->carry_len == 0){
+        return 0;
+    }
+    char *p = encode_tail(out, enc->carry, enc->carry_len, base64_pairs(enc->alphabet), enc->pad);
+    enc->carry_len = 0;
+    return p - out;
+}
+
+void base64DecoderInit(Base64Decoder *dec){
+    memset(dec, 0, sizeof(Base64Decoder));
+}
+
+// Flushes the bytes held by a partial quad of 2 or 3 sextets.
+static size_t decode_partial(Base64Decoder *dec, uint8_t *out){
+    if(dec->count == 2){
+        out[0] = (uint8_t)(dec->acc >> 4);
+        return 1;
+    }
+    out[0] = (uint8_t)(dec->acc >> 10);
+    out[1] = (uint8_t)(dec->acc >> 2);
+    return 2;
+}
+
+esp_err_t base64DecoderUpdate(Base64Decoder *dec, uint8_t *out, size_t out_size, const char *in, size_t len, size_t *out_len){
+    const uint8_t *s = (const uint8_t *)in;
+    const uint8_t *end = s + len;
+    size_t o = 0;
+
+    while(s < end){
+        if(dec->count == 0 && !dec->padded){
+            // Whole quads: four lookups, one validity check, three bytes out.
+            while(end - s >= 4 && out_size - o >= 3){
+                uint8_t a = base64Values[s[0]], b = base64Values[s[1]];
+                uint8_t c = base64Values[s[2]], d = base64Values[s[3]];
+                if((a | b | c | d) & 0x80){
+                    break;
+                }
+                uint32_t word = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | d;
+                out[o] = (uint8_t)(word >> 16);
+                out[o + 1] = (uint8_t)(word >> 8);
+                out[o + 2] = (uint8_t)word;
+                o += 3;
+                s += 4;
+            }
+            if(s == end){
+                break;
+            }
+        }
+        // One character at a time: chunk edges, padding and errors.
+        uint8_t c = *s++;
+        if(c == '='){
+            if(dec->count < 2 || (dec->padded && dec->count == 4)){
+                ESP_LOGE(TAG, "Unexpected padding");
+                return ESP_ERR_INVALID_ARG;
+            }
+            if(!dec->padded){
+                if(out_size - o < (size_t)dec->count - 1){
+                    return ESP_ERR_INVALID_SIZE;
+                }
+                o += decode_partial(dec, out + o);
+                dec->padded = true;
+            }
+            dec->count++;
+            continue;
+        }
+        uint8_t v = base64Values[c];
+        if(v == B64_INVALID || dec->padded){
+            ESP_LOGE(TAG, "Invalid character 0x%02x", c);
+            return ESP_ERR_INVALID_ARG;
+        }
+        dec->acc = (dec->acc << 6) | v;
+        if(++dec->count == 4){
+            if(out_size - o < 3){
+                return ESP_ERR_INVALID_SIZE;
+            }
+            out[o++] = (uint8_t)(dec->acc >> 16);
+            out[o++] = (uint8_t)(dec->acc >> 8);
+            out[o++] = (uint8_t)dec->acc;
+            dec->acc = 0;
+            dec->count = 0;
+        }
+    }
+    *out_len = o;
+    return ESP_OK;
+}
+
+esp_err_t base64DecoderFinish(Base64Decoder *dec, uint8_t *out, size_t out_size, size_t *out_len){
+    *out_len = 0;
+    if(dec->padded || dec->count == 0){
+        base64DecoderInit(dec);
+        return ESP_OK;
+    }
+    if(dec->count == 1){
+        ESP_LOGE(TAG, "Truncated input");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(out_size < (size_t)dec->count - 1){
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *out_len = decode_partial(dec, out);
+    base64DecoderInit(dec);
+    return ESP_OK;
+}
+
+esp_err_t base64Decode(uint8_t *out, size_t out_size, const char *in, size_t len, size_t *out_len){
+    if(out == NULL || out_len == NULL || (in == NULL && len > 0)){
+        return ESP_ERR_INVALID_ARG;
+    }
+    Base64Decoder dec;
+    size_t body_len, tail_len;
+    base64DecoderInit(&dec);
+    esp_err_t err = base64DecoderUpdate(&dec, out, out_size, in, len, &body_len);
+    if(err == ESP_OK){
+        err = base64DecoderFinish(&dec, out + body_len, out_size - body_len, &tail_len);
+    }
+    *out_len = err == ESP_OK ? body_len + tail_len : 0;
+    return err;
+}
+
+#if CONFIG_BASE64_BENCHMARK
+#include <stdlib.h>
+#include "esp_random.h"
+#include "micro_bench.h"
+#include "mbedtls/base64.h"
+
+/*
+ * Encodes and decodes len random bytes rounds times with this codec and
+ * with mbedtls, checks that both agree and logs each stage. The unpadded
+ * URL encoding is the one the JWT uses.
+ */
+void base64Benchmark(size_t len, int rounds){
+    size_t enc_size = BASE64_ENCODED_LEN(len, true) + 1;
+    uint8_t *data = (uint8_t *)memAlloc(len);
+    uint8_t *decoded = (uint8_t *)memAlloc(len + 3);
+    char *encoded = (char *)memAlloc(enc_size);
+    char *reference = (char *)memAlloc(enc_size);
+    size_t enc_len = 0, ref_len = 0, dec_len = 0;
+    MicroBench bench;
+    if(data == NULL || decoded == NULL || encoded == NULL || reference == NULL){
+        ESP_LOGE(TAG, "Failed to allocate benchmark buffers");
+        goto cleanup;
+    }
+    esp_fill_random(data, len);
+    ESP_LOGI(TAG, "%u bytes x %d rounds", (unsigned)len, rounds);
+
+    microBenchBegin(&bench, "base64 encode", rounds);
+    for(int i = 0; i < rounds; i++){
+        enc_len = base64Encode(encoded, enc_size, data, len, BASE64_STANDARD, true);
+    }
+    microBenchEnd(&bench);
+
+    microBenchBegin(&bench, "mbedtls encode", rounds);
+    for(int i = 0; i < rounds; i++){
+        mbedtls_base64_encode((unsigned char *)reference, enc_size, &ref_len, data, len);
+    }
+    microBenchEnd(&bench);
+
+    if(enc_len != ref_len || memcmp(encoded, reference, enc_len) != 0){
+        ESP_LOGE(TAG, "Encoder output differs from mbedtls");
+        goto cleanup;
+    }
+
+    microBenchBegin(&bench, "base64url encode", rounds);
+    for(int i = 0; i < rounds; i++){
+        base64Encode(reference, enc_size, data, len, BASE64_URL, false);
+    }
+    microBenchEnd(&bench);
+
+    microBenchBegin(&bench, "base64 decode", rounds);
+    for(int i = 0; i < rounds; i++){
+        base64Decode(decoded, len, encoded, enc_len, &dec_len);
+    }
+    microBenchEnd(&bench);
+    if(dec_len != len || memcmp(decoded, data, len) != 0){
+        ESP_LOGE(TAG, "Decoder output differs from the input");
+        goto cleanup;
+    }
+
+    microBenchBegin(&bench, "mbedtls decode", rounds);
+    for(int i = 0; i < rounds; i++){
+        mbedtls_base64_decode(decoded, len + 3, &dec_len, (const unsigned char *)encoded, enc_len);
+    }
+    microBenchEnd(&bench);
+
+    // Both padded tails must fit a buffer of exactly the decoded size.
+    for(size_t tail = 1; tail <= 2 && tail <= len; tail++){
+        enc_len = base64Encode(encoded, enc_size, data, tail, BASE64_STANDARD, true);
+        if(base64Decode(decoded, tail, encoded, enc_len, &dec_len) != ESP_OK || dec_len != tail ||
+           memcmp(decoded, data, tail) != 0){
+            ESP_LOGE(TAG, "Padded %u byte input does not decode into an exact buffer", (unsigned)tail);
+            goto cleanup;
+        }
+    }
+
+cleanup:
+    memFree(data);
+    memFree(decoded);
+    memFree(encoded);
+    memFree(reference);
+}
+#endif
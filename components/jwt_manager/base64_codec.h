@@ -0,0 +1,91 @@
+/**
+ * base64_codec.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef BASE64_CODEC_H
+#define BASE64_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+// Characters produced for len input bytes, excluding the NUL.
+#define BASE64_ENCODED_LEN(len, pad) ((pad) ? (((len) + 2) / 3 * 4) : (((len) * 4 + 2) / 3))
+// Upper bound on the bytes decoded from len characters.
+#define BASE64_DECODED_MAX_LEN(len) (((len) + 3) / 4 * 3)
+
+typedef enum{
+    BASE64_STANDARD,
+    BASE64_URL,
+}base64_alphabet_t;
+
+/*
+ * Streaming encoder. Up to two bytes that do not fill a 3-byte group are
+ * carried over to the next update. Each update writes at most
+ * BASE64_ENCODED_LEN(len + 2, true) characters, and finish writes at most 4.
+ * Neither one NUL-terminates.
+ */
+typedef struct Base64Encoder{
+    base64_alphabet_t alphabet;
+    bool pad;
+    uint8_t carry[2];
+    uint8_t carry_len;
+}Base64Encoder;
+
+/*
+ * Streaming decoder. It accepts both alphabets, carries a partial quad over
+ * to the next update, and rejects anything after padding. Padding is
+ * optional.
+ */
+typedef struct Base64Decoder{
+    uint32_t acc;
+    uint8_t count;
+    bool padded;
+}Base64Decoder;
+
+/*
+ * One-shot helpers. base64Encode NUL-terminates and returns the number of
+ * characters written, or 0 when out_size is too small. base64Decode may
+ * write over its own input as long as out starts at or before in, which
+ * is how pulled payloads are decoded in place.
+ */
+size_t base64Encode(char *out, size_t out_size, const uint8_t *in, size_t len, base64_alphabet_t alphabet, bool pad);
+esp_err_t base64Decode(uint8_t *out, size_t out_size, const char *in, size_t len, size_t *out_len);
+
+void base64EncoderInit(Base64Encoder *enc, base64_alphabet_t alphabet, bool pad);
+size_t base64EncoderUpdate(Base64Encoder *enc, char *out, const uint8_t *in, size_t len);
+size_t base64EncoderFinish(Base64Encoder *enc, char *out);
+
+void base64DecoderInit(Base64Decoder *dec);
+esp_err_t base64DecoderUpdate(Base64Decoder *dec, uint8_t *out, size_t out_size, const char *in, size_t len, size_t *out_len);
+esp_err_t base64DecoderFinish(Base64Decoder *dec, uint8_t *out, size_t out_size, size_t *out_len);
+
+#if CONFIG_BASE64_BENCHMARK
+void base64Benchmark(size_t len, int rounds);
+#endif
+
+#endif // BASE64_CODEC_H
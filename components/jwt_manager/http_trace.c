@@ -0,0 +1,235 @@
+/**
+ * http_trace.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "http_trace.h"
+
+#if CONFIG_HTTP_TRACE
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "HttpTrace";
+
+/*
+ * Log-linear buckets: four per power of two from 16 us up to 2^27 us
+ * (134 s), so each bucket is at most 25% wider than the one before.
+ */
+#define HTTP_TRACE_MIN_BITS 4
+#define HTTP_TRACE_MAX_BITS 27
+#define HTTP_TRACE_SUB_BITS 2
+#define HTTP_TRACE_BUCKETS ((HTTP_TRACE_MAX_BITS - HTTP_TRACE_MIN_BITS) << HTTP_TRACE_SUB_BITS)
+
+typedef struct{
+    uint32_t buckets[HTTP_TRACE_BUCKETS];
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+}Histogram;
+
+typedef struct{
+    uint32_t requests;
+    uint32_t errors;
+    Histogram phase[HTTP_PHASE_COUNT];
+    HttpTrace last;
+}OpTrace;
+
+static OpTrace traces[HTTP_TRACE_OP_COUNT];
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const op_names[HTTP_TRACE_OP_COUNT] = { "publish", "pull", "ack", "token" };
+static const char *const phase_names[HTTP_PHASE_COUNT] = { "connect", "send", "wait", "receive", "total" };
+
+static int bucket_of(uint32_t us){
+    if(us < (1u << HTTP_TRACE_MIN_BITS)){
+        return 0;
+    }
+    if(us >= (1u << HTTP_TRACE_MAX_BITS)){
+        return HTTP_TRACE_BUCKETS - 1;
+    }
+    int msb = 31 - __builtin_clz(us);
+    return ((msb - HTTP_TRACE_MIN_BITS) << HTTP_TRACE_SUB_BITS) +
+           ((us >> (msb - HTTP_TRACE_SUB_BITS)) & ((1u << HTTP_TRACE_SUB_BITS) - 1));
+}
+
+// First value past the bucket, the bound reported for a percentile.
+static uint32_t bucket_limit(int bucket){
+    int msb = (bucket >> HTTP_TRACE_SUB_BITS) + HTTP_TRACE_MIN_BITS;
+    uint32_t sub = bucket & ((1u << HTTP_TRACE_SUB_BITS) - 1);
+    return ((1u << HTTP_TRACE_SUB_BITS) + sub + 1) << (msb - HTTP_TRACE_SUB_BITS);
+}
+
+static void histogram_add(Histogram *h, int64_t from, int64_t to){
+    if(from == 0 || to < from){
+        return;
+    }
+    uint32_t us = to - from > UINT32_MAX ? UINT32_MAX : (uint32_t)(to - from);
+    h->buckets[bucket_of(us)]++;
+    h->count++;
+    h->total_us += us;
+    if(us > h->max_us){
+        h->max_us = us;
+    }
+}
+
+static void histogram_stats(const Histogram *h, HttpLatencyStats *stats){
+    static const uint32_t percent[] = { 50, 95, 99 };
+    uint32_t *out[] = { &stats->p50_us, &stats->p95_us, &stats->p99_us };
+    memset(stats, 0, sizeof(HttpLatencyStats));
+    stats->count = h->count;
+    stats->max_us = h->max_us;
+    stats->total_us = h->total_us;
+    uint32_t seen = 0;
+    size_t p = 0;
+    for(int i = 0; i < HTTP_TRACE_BUCKETS && p < 3; i++){
+        seen += h->buckets[i];
+        while(p < 3 && (uint64_t)seen * 100 >= (uint64_t)h->count * percent[p] && seen > 0){
+            uint32_t limit = bucket_limit(i);
+            *out[p++] = limit < h->max_us ? limit : h->max_us;
+        }
+    }
+}
+
+void httpTraceBegin(HttpTrace *trace){
+    memset(trace, 0, sizeof(HttpTrace));
+    trace->start_us = esp_timer_get_time();
+}
+
+void httpTraceEvent(HttpTrace *trace, esp_http_client_event_id_t event){
+    switch(event){
+        case HTTP_EVENT_ON_CONNECTED:
+            // A retry on a new connection starts the later phases over.
+            trace->connected_us = esp_timer_get_time();
+            trace->headers_sent_us = 0;
+            trace->first_header_us = 0;
+            trace->finish_us = 0;
+            break;
+        case HTTP_EVENT_HEADERS_SENT:
+            trace->headers_sent_us = esp_timer_get_time();
+            break;
+        case HTTP_EVENT_ON_HEADER:
+            if(trace->first_header_us == 0){
+                trace->first_header_us = esp_timer_get_time();
+            }
+            break;
+        case HTTP_EVENT_ON_FINISH:
+            trace->finish_us = esp_timer_get_time();
+            break;
+        default:
+            break;
+    }
+}
+
+void httpTraceEnd(HttpTrace *trace, http_trace_op_t op, esp_err_t err){
+    trace->end_us = esp_timer_get_time();
+    trace->err = err;
+    if(op >= HTTP_TRACE_OP_COUNT || trace->start_us == 0){
+        return;
+    }
+    int64_t sent_from = trace->connected_us != 0 ? trace->connected_us : trace->start_us;
+    int64_t received = trace->finish_us != 0 ? trace->finish_us : trace->end_us;
+    OpTrace *t = &traces[op];
+
+    portENTER_CRITICAL(&trace_lock);
+    t->requests++;
+    t->last = *trace;
+    if(err != ESP_OK){
+        t->errors++;
+    }else{
+        histogram_add(&t->phase[HTTP_PHASE_CONNECT], trace->connected_us != 0 ? trace->start_us : 0, trace->connected_us);
+        histogram_add(&t->phase[HTTP_PHASE_SEND], trace->headers_sent_us != 0 ? sent_from : 0, trace->headers_sent_us);
+        histogram_add(&t->phase[HTTP_PHASE_WAIT], trace->headers_sent_us, trace->first_header_us);
+        histogram_add(&t->phase[HTTP_PHASE_RECEIVE], trace->first_header_us, received);
+        histogram_add(&t->phase[HTTP_PHASE_TOTAL], trace->start_us, trace->end_us);
+    }
+    portEXIT_CRITICAL(&trace_lock);
+
+    ESP_LOGD(TAG, "%s %s: connect %lld send %lld wait %lld receive %lld total %lld us", op_names[op],
+             esp_err_to_name(err), (long long)(trace->connected_us ? trace->connected_us - trace->start_us : 0),
+             (long long)(trace->headers_sent_us ? trace->headers_sent_us - sent_from : 0),
+             (long long)(trace->first_header_us && trace->headers_sent_us ? trace->first_header_us - trace->headers_sent_us : 0),
+             (long long)(trace->first_header_us ? received - trace->first_header_us : 0),
+             (long long)(trace->end_us - trace->start_us));
+}
+
+esp_err_t httpTraceGetStats(http_trace_op_t op, HttpOpStats *stats){
+    if(op >= HTTP_TRACE_OP_COUNT || stats == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&trace_lock);
+    stats->requests = traces[op].requests;
+    stats->errors = traces[op].errors;
+    for(int i = 0; i < HTTP_PHASE_COUNT; i++){
+        histogram_stats(&traces[op].phase[i], &stats->phase[i]);
+    }
+    portEXIT_CRITICAL(&trace_lock);
+    return ESP_OK;
+}
+
+esp_err_t httpTraceGetLast(http_trace_op_t op, HttpTrace *trace){
+    if(op >= HTTP_TRACE_OP_COUNT || trace == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&trace_lock);
+    *trace = traces[op].last;
+    portEXIT_CRITICAL(&trace_lock);
+    return trace->start_us != 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void httpTraceReset(void){
+    portENTER_CRITICAL(&trace_lock);
+    memset(traces, 0, sizeof(traces));
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+const char *httpTraceOpName(http_trace_op_t op){
+    return op < HTTP_TRACE_OP_COUNT ? op_names[op] : "unknown";
+}
+
+const char *httpTracePhaseName(http_trace_phase_t phase){
+    return phase < HTTP_PHASE_COUNT ? phase_names[phase] : "unknown";
+}
+
+void httpTraceDump(void){
+    HttpOpStats stats;
+    for(int op = 0; op < HTTP_TRACE_OP_COUNT; op++){
+        if(httpTraceGetStats((http_trace_op_t)op, &stats) != ESP_OK || stats.requests == 0){
+            continue;
+        }
+        ESP_LOGI(TAG, "%s: %lu requests, %lu failed", op_names[op], (unsigned long)stats.requests,
+                 (unsigned long)stats.errors);
+        for(int i = 0; i < HTTP_PHASE_COUNT; i++){
+            const HttpLatencyStats *s = &stats.phase[i];
+            if(s->count == 0){
+                continue;
+            }
+            ESP_LOGI(TAG, "  %-8s %6lu x  p50 %8.2f  p95 %8.2f  p99 %8.2f  max %8.2f ms", phase_names[i],
+                     (unsigned long)s->count, s->p50_us / 1000.0, s->p95_us / 1000.0, s->p99_us / 1000.0,
+                     s->max_us / 1000.0);
+        }
+    }
+}
+#endif
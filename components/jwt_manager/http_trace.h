@@ -0,0 +1,114 @@
+/**
+ * http_trace.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef HTTP_TRACE_H
+#define HTTP_TRACE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include "sdkconfig.h"
+
+typedef enum{
+    HTTP_TRACE_PUBLISH,
+    HTTP_TRACE_PULL,
+    HTTP_TRACE_ACKNOWLEDGE,
+    HTTP_TRACE_TOKEN,
+    HTTP_TRACE_OP_COUNT
+}http_trace_op_t;
+
+/*
+ * connect: DNS, TCP and TLS of a new connection, esp_http_client reports
+ * them as one step. send: up to the request headers being written. wait:
+ * the body upload plus the server's time to the first response header.
+ * receive: the rest of the response. total: the whole call, retries
+ * included.
+ */
+typedef enum{
+    HTTP_PHASE_CONNECT,
+    HTTP_PHASE_SEND,
+    HTTP_PHASE_WAIT,
+    HTTP_PHASE_RECEIVE,
+    HTTP_PHASE_TOTAL,
+    HTTP_PHASE_COUNT
+}http_trace_phase_t;
+
+/* Timestamps of one request in esp_timer microseconds, 0 if not reached. */
+typedef struct{
+    int64_t start_us;
+    int64_t connected_us;
+    int64_t headers_sent_us;
+    int64_t first_header_us;
+    int64_t finish_us;
+    int64_t end_us;
+    esp_err_t err;
+}HttpTrace;
+
+typedef struct{
+    uint32_t count;
+    uint32_t p50_us;
+    uint32_t p95_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+    uint64_t total_us;
+}HttpLatencyStats;
+
+typedef struct{
+    uint32_t requests;
+    uint32_t errors;
+    HttpLatencyStats phase[HTTP_PHASE_COUNT];
+}HttpOpStats;
+
+#if CONFIG_HTTP_TRACE
+/*
+ * Call begin before a request, event from its esp_http_client event handler
+ * and end once it returned. Successful requests go into per-operation
+ * histograms with buckets up to 25% wide, so percentiles are upper bounds of
+ * that accuracy. Safe to use from several tasks.
+ */
+void httpTraceBegin(HttpTrace *trace);
+void httpTraceEvent(HttpTrace *trace, esp_http_client_event_id_t event);
+void httpTraceEnd(HttpTrace *trace, http_trace_op_t op, esp_err_t err);
+
+esp_err_t httpTraceGetStats(http_trace_op_t op, HttpOpStats *stats);
+esp_err_t httpTraceGetLast(http_trace_op_t op, HttpTrace *trace);
+void httpTraceReset(void);
+void httpTraceDump(void);
+const char *httpTraceOpName(http_trace_op_t op);
+const char *httpTracePhaseName(http_trace_phase_t phase);
+#else
+static inline void httpTraceBegin(HttpTrace *trace){ (void)trace; }
+static inline void httpTraceEvent(HttpTrace *trace, esp_http_client_event_id_t event){ (void)trace; (void)event; }
+static inline void httpTraceEnd(HttpTrace *trace, http_trace_op_t op, esp_err_t err){ (void)trace; (void)op; (void)err; }
+static inline esp_err_t httpTraceGetStats(http_trace_op_t op, HttpOpStats *stats){ return ESP_ERR_NOT_SUPPORTED; }
+static inline esp_err_t httpTraceGetLast(http_trace_op_t op, HttpTrace *trace){ return ESP_ERR_NOT_SUPPORTED; }
+static inline void httpTraceReset(void){}
+static inline void httpTraceDump(void){}
+static inline const char *httpTraceOpName(http_trace_op_t op){ return ""; }
+static inline const char *httpTracePhaseName(http_trace_phase_t phase){ return ""; }
+#endif
+
+#endif // HTTP_TRACE_H
@@ -31,6 +31,8 @@
 #include "esp_http_client.h"
 #include "cJSON.h"
 #include "jwt_manager.h"
+#include "mem_alloc.h"
+#include "base64_codec.h"
 #include "mbedtls/rsa.h"
 #include "mbedtls/pem.h"
 #include "mbedtls/sha256.h"
@@ -44,67 +46,26 @@
 #include "esp_system.h" 
 #include "esp_mac.h"
 #include "esp_err.h"
+#include "esp_timer.h"
 #include <esp_crt_bundle.h>
 
 static const char *TAG = "JWTManager";
 
-static bool encodeBase64(char *encoded, unsigned char *string, size_t len,char *base64EncBuff)
-{
-    size_t i;
-    char *p = encoded;
-    if(!encoded || !string) return false;
-    
-    for (i = 0; i < len -2; i += 3)
-    {
-        *p++ = base64EncBuff[(string[i] >> 2) & 0x3F];
-        *p++ = base64EncBuff[((string[i] & 0x3) << 4) | ((int)(string[i + 1] & 0xF0) >> 4)];
-        *p++ = base64EncBuff[((string[i + 1] & 0xF) << 2) | ((int)(string[i + 2] & 0xC0) >> 6)];
-        *p++ = base64EncBuff[string[i + 2] & 0x3F];
-    }
-
-    if (i < len)
-    {
-        *p++ = base64EncBuff[(string[i] >> 2) & 0x3F];
-        if (i == (len - 1))
-            *p++ = base64EncBuff[((string[i] & 0x3) << 4)];
-        else
-        {
-            *p++ = base64EncBuff[((string[i] & 0x3) << 4) | ((int)(string[i + 1] & 0xF0) >> 4)];
-            *p++ = base64EncBuff[((string[i + 1] & 0xF) << 2)];
-        }
-    }
-    *p++ = '\0';
-    return true;
-}
-
-bool concatStrings(char **str1, char *str2) {
-    
-    if (str2 == NULL) {
-        ESP_LOGI(TAG, "concatStrings: str2 is null");
-        return false;
-    }
-
-    size_t len1 = (*str1 != NULL) ? strlen(*str1) : 0;
-    size_t len2 = strlen(str2);
-    size_t totalLength = len1 + len2 + 1; 
-
-    char *combined = (char *)realloc(*str1,totalLength);  
-    
-    if (combined == NULL) {
-        ESP_LOGI(TAG, "concatStrings: failed to allocate memory");
-        return false;
-    }
-
-    *str1 = combined;  
-    strcpy(combined + len1, str2);  
-    return true;
-}
-
 JWTConfig *new_JWTConfig() {
-    JWTConfig *myConfig = calloc(1,sizeof(JWTConfig));
+    JWTConfig *myConfig = memCalloc(1,sizeof(JWTConfig));
     myConfig->init_JWT_Auth = init_JWT_Auth;
     return myConfig;
 }
+void delete_JWTConfig(JWTConfig *myConfig){
+    if(myConfig == NULL){
+        return;
+    }
+    delete_JWTSigner(myConfig->signer);
+    memFree(myConfig->Access_Token);
+    memFree(myConfig->jwt_components.buffer);
+    strBuilderFree(&myConfig->response_body);
+    memFree(myConfig);
+}
 static void init_JWT_Auth(JWTConfig *myConfig){
     if(myConfig){
         myConfig->token_error = false;
@@ -135,106 +96,81 @@ static time_t getTime() {
     return now; 
 }
 
-char * base64encodeUrl(unsigned char *input, size_t length){
-    return base64_encode(input,length,true);
-}
-
-char * base64encodeData(unsigned char *input, size_t length){
-    return base64_encode(input,length,false);
+static size_t jwt_encode_url(JWTComponents *jwt, const unsigned char *input, size_t len){
+    char *encoded = jwt->jwt + jwt->jwt_len;
+    return base64Encode(encoded, jwt->scratch - encoded, input, len, BASE64_URL, false);
 }
 
-static char* base64_encode(unsigned char *input, size_t length,bool url) {
-    if(!input || length <1) return NULL;
-
-    char *output = CREATE_CHAR_BUFFER(MBEDTLS_BASE64_ENCODE_OUTPUT(length));
-    if (!output) {
-        ESP_LOGE(TAG, "Failed to allocate memory for Base64 output");
-        return NULL;
+/*
+ * One allocation holds the whole token request: the form prefix, the JWT
+ * itself and a scratch area for the raw claims and signature. It is sized
+ * for the worst case once and only grows if the client email does.
+ */
+static esp_err_t jwt_prepare_buffer(JWTConfig *myConfig){
+    JWTComponents *jwt = &myConfig->jwt_components;
+    if(myConfig->client_email == NULL){
+        ESP_LOGE(TAG, "client_email is not set");
+        return ESP_ERR_INVALID_ARG;
     }
-    char* base64buff = url ? base64EncBuffUrl:base64EncBuffData;
-    encodeBase64(output,input,length,base64buff);
-    return output;
-}
-
-void jwt_encoded_genrate_header(JWTConfig *myConfig){
-
-    cJSON *jsonPtr = cJSON_CreateObject();
-    if (!jsonPtr) {
-        ESP_LOGE(TAG, "Failed to create JSON object");
-        return;
+    if(myConfig->signer == NULL){
+        myConfig->signer = new_JWTSigner(myConfig->private_key);
+        if(myConfig->signer == NULL){
+            return ESP_FAIL;
+        }
     }
-
-    cJSON_AddItemToObject(jsonPtr, esp_signer_gauth_pgm_str_20, cJSON_CreateString("RS256")); 
-    cJSON_AddItemToObject(jsonPtr, esp_signer_gauth_pgm_str_22, cJSON_CreateString("JWT"));   
-
-    myConfig->jwt_components.header = cJSON_PrintUnformatted(jsonPtr);
-    if (!myConfig->jwt_components.header) {
-        ESP_LOGE(TAG, "Failed to print JSON");
-        cJSON_Delete(jsonPtr);
-        return;
+    size_t claims_size = sizeof(JWT_CLAIMS_FORMAT) + 2 * strlen(myConfig->client_email) +
+                         sizeof(googleapis_auth2_url) + sizeof(googleapis_scope_url) + 2 * JWT_TIME_DIGITS;
+    size_t signature_size = mbedtls_pk_get_len(&myConfig->signer->pk);
+    size_t scratch_size = claims_size > signature_size ? claims_size : signature_size;
+    size_t jwt_size = sizeof(JWT_ENCODED_HEADER) + BASE64_ENCODED_LEN(claims_size, false) + 1 +
+                      BASE64_ENCODED_LEN(signature_size, false) + 1;
+    size_t buffer_size = sizeof(JWT_ASSERTION_PREFIX) - 1 + jwt_size + scratch_size;
+
+    if(jwt->buffer == NULL || jwt->buffer_size < buffer_size){
+        char *buffer = (char *)memRealloc(jwt->buffer, buffer_size);
+        if(buffer == NULL){
+            ESP_LOGE(TAG, "Failed to allocate memory for JWT buffer");
+            return ESP_ERR_NO_MEM;
+        }
+        jwt->buffer = buffer;
+        jwt->buffer_size = buffer_size;
+        memcpy(jwt->buffer, JWT_ASSERTION_PREFIX, sizeof(JWT_ASSERTION_PREFIX) - 1);
+        ESP_LOGI(TAG, "JWT buffer sized to %u bytes", (unsigned)buffer_size);
     }
+    jwt->jwt = jwt->buffer + sizeof(JWT_ASSERTION_PREFIX) - 1;
+    jwt->scratch = jwt->jwt + jwt_size;
+    jwt->scratch_size = scratch_size;
+    return ESP_OK;
+}
 
-    myConfig->jwt_components.encHeader = base64encodeUrl((unsigned char *)myConfig->jwt_components.header, strlen(myConfig->jwt_components.header));
-    if (!myConfig->jwt_components.encHeader) {
-        ESP_LOGE(TAG, "Failed to encode JSON to Base64");
-        free(myConfig->jwt_components.header);
-        cJSON_Delete(jsonPtr);
+void jwt_encoded_genrate_header(JWTConfig *myConfig){
+    if(jwt_prepare_buffer(myConfig) != ESP_OK){
         return;
     }
-    myConfig->jwt_components.encHeadPayload = myConfig->jwt_components.encHeader;
-   // ESP_LOGI(TAG, "Encoded Header: %s , %s", myConfig->encHeadPayload,myConfig->header);
-    free(myConfig->jwt_components.header);
-    cJSON_Delete(jsonPtr);
+    JWTComponents *jwt = &myConfig->jwt_components;
+    // The header never changes, so its encoding is a compile-time constant.
+    memcpy(jwt->jwt, JWT_ENCODED_HEADER, sizeof(JWT_ENCODED_HEADER) - 1);
+    jwt->jwt[sizeof(JWT_ENCODED_HEADER) - 1] = '.';
+    jwt->jwt_len = sizeof(JWT_ENCODED_HEADER);
     myConfig->step = step_jwt_encoded_genrate_payload;
 }
 
 void jwt_encoded_genrate_payload(JWTConfig *myConfig){
-    time_t now;
-
-    if(!myConfig->time_sync_finished){
-        now =  getTime(); 
-        myConfig->time_sync_finished = true;
-    }else{
-        now = time(NULL);
-    }
-    cJSON *jsonPtr = cJSON_CreateObject();
-
-    if (!jsonPtr) {
-        ESP_LOGE(TAG, "Failed to create JSON object");
-        return;
-    }
-
-    cJSON_AddStringToObject(jsonPtr, esp_signer_gauth_pgm_str_24, myConfig->client_email);
-    cJSON_AddStringToObject(jsonPtr, esp_signer_gauth_pgm_str_25, myConfig->client_email);
-
-    cJSON_AddStringToObject(jsonPtr, esp_signer_gauth_pgm_str_47, googleapis_auth2_url);
-    cJSON_AddNumberToObject(jsonPtr, esp_signer_gauth_pgm_str_31, (int)now);
-    cJSON_AddNumberToObject(jsonPtr, esp_signer_gauth_pgm_str_32, (int)(now + 3600));
-    cJSON_AddStringToObject(jsonPtr, esp_signer_gauth_pgm_str_33, googleapis_scope_url);
-
-    myConfig->jwt_components.payload = cJSON_PrintUnformatted(jsonPtr); 
-    if(myConfig->jwt_components.payload == NULL){
-        ESP_LOGE(TAG, "Failed to encode JSON to Base64");
-        cJSON_Delete(jsonPtr); 
-        return;
-    }
-
-    myConfig->jwt_components.encPayload = base64encodeUrl((unsigned char *)myConfig->jwt_components.payload, strlen(myConfig->jwt_components.payload));
-    if(myConfig->jwt_components.encPayload == NULL){
-        ESP_LOGE(TAG, "Failed to encode JSON to Base64");
-        free(myConfig->jwt_components.payload);
-        cJSON_Delete(jsonPtr);
+    jwt_sync_time(myConfig);
+    JWTComponents *jwt = &myConfig->jwt_components;
+    time_t now = time(NULL);
+
+    int claims_len = snprintf(jwt->scratch, jwt->scratch_size, JWT_CLAIMS_FORMAT,
+                              myConfig->client_email, myConfig->client_email, googleapis_auth2_url,
+                              (long long)now, (long long)(now + JWT_TOKEN_LIFETIME_S), googleapis_scope_url);
+    if(claims_len < 0 || (size_t)claims_len >= jwt->scratch_size){
+        ESP_LOGE(TAG, "JWT claims do not fit the buffer");
+        myConfig->step = step_jwt_encoded_genrate_header;
         return;
     }
 
-    concatStrings(&myConfig->jwt_components.encHeadPayload,esp_signer_gauth_pgm_str_35);
-    concatStrings(&myConfig->jwt_components.encHeadPayload,myConfig->jwt_components.encPayload);
-
-    //ESP_LOGI(TAG, "Encoded Payload: %s , %s", myConfig->payload,myConfig->encHeadPayload);
-
-    free(myConfig->jwt_components.payload); 
-    free(myConfig->jwt_components.encPayload);  
-    cJSON_Delete(jsonPtr); 
+    jwt->jwt_len += jwt_encode_url(jwt, (unsigned char *)jwt->scratch, claims_len);
+    jwt->signing_len = jwt->jwt_len;
     myConfig->step = step_jwt_gen_hash;
 }
 
@@ -247,94 +183,99 @@ static int mbedtls_error_log(int error){
         }
         mbedtls_strerror(-error, error_buf, ERROR_BUFFER_SIZE);
         ESP_LOGE(TAG,"Error: %s\n", error_buf); 
-        free(error_buf);
+        memFree(error_buf);
     }
     return error;
 }
 
 void jwt_gen_hash(JWTConfig *myConfig){
-    mbedtls_sha256_context sha_ctx;
-    mbedtls_sha256_init(&sha_ctx);
-
-    if(mbedtls_error_log(mbedtls_sha256_starts(&sha_ctx, 0))<0){
-        mbedtls_sha256_free(&sha_ctx);
-        return;
-    }
-
-    if(mbedtls_error_log(mbedtls_sha256_update(&sha_ctx, 
-                        (unsigned char *)myConfig->jwt_components.encHeadPayload, strlen(myConfig->jwt_components.encHeadPayload)))<0){
-        mbedtls_sha256_free(&sha_ctx);
-        return; 
-    }
-    
-    myConfig->jwt_components.hash = CREATE_CHAR_BUFFER(myConfig->hashSize);
-    if (myConfig->jwt_components.hash == NULL) {
-        return;
-    }
-
-    if(mbedtls_error_log(mbedtls_sha256_finish(&sha_ctx, (unsigned char *)myConfig->jwt_components.hash))<0){
-        mbedtls_sha256_free(&sha_ctx);
+    JWTComponents *jwt = &myConfig->jwt_components;
+    if(mbedtls_error_log(mbedtls_sha256((unsigned char *)jwt->jwt, jwt->signing_len, jwt->hash, 0))<0){
+        myConfig->step = step_jwt_encoded_genrate_header;
         return;
     }
-
-    mbedtls_sha256_free(&sha_ctx);
     myConfig->step = step_sign_jwt;
 }
 int my_rng(void *ctx, unsigned char *output, size_t len) {
     return mbedtls_ctr_drbg_random((mbedtls_ctr_drbg_context *)ctx, output, len);
 }
 
-void sign_jwt(JWTConfig *myConfig){  
-    concatStrings(&myConfig->jwt_components.jwt,myConfig->jwt_components.encHeadPayload);
-    free(myConfig->jwt_components.encHeadPayload);
-    concatStrings(&myConfig->jwt_components.jwt,esp_signer_gauth_pgm_str_35);
-    mbedtls_pk_context pk;
-    mbedtls_entropy_context entropy;
-    mbedtls_ctr_drbg_context ctr_drbg;
-
-    mbedtls_pk_init(&pk);
-    mbedtls_entropy_init(&entropy);
-    mbedtls_ctr_drbg_init(&ctr_drbg);
-
-    if(mbedtls_error_log(mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func , &entropy, NULL, 0))<0)return;
+JWTSigner *new_JWTSigner(const char *private_key){
+    if(private_key == NULL){
+        return NULL;
+    }
+    JWTSigner *signer = (JWTSigner *)memCalloc(1, sizeof(JWTSigner));
+    if(signer == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory for JWTSigner");
+        return NULL;
+    }
+    mbedtls_pk_init(&signer->pk);
+    mbedtls_entropy_init(&signer->entropy);
+    mbedtls_ctr_drbg_init(&signer->ctr_drbg);
+
+    int64_t start = esp_timer_get_time();
+    if(mbedtls_error_log(mbedtls_ctr_drbg_seed(&signer->ctr_drbg, mbedtls_entropy_func , &signer->entropy, NULL, 0))<0 ||
+       mbedtls_error_log(mbedtls_pk_parse_key(&signer->pk, (const unsigned char *)private_key,
+                                strlen(private_key) + 1, NULL, 0, mbedtls_ctr_drbg_random,
+                                &signer->ctr_drbg))<0){
+        delete_JWTSigner(signer);
+        return NULL;
+    }
+    signer->setup_us = esp_timer_get_time() - start;
+    ESP_LOGI(TAG, "Private key parsed and DRBG seeded in %lld us", (long long)signer->setup_us);
+    return signer;
+}
 
-    if(mbedtls_error_log(mbedtls_pk_parse_key(&pk, (const unsigned char *)myConfig->private_key, 
-                                strlen(myConfig->private_key) + 1, NULL, 0, mbedtls_ctr_drbg_random,
-                                &ctr_drbg))<0){
-        mbedtls_pk_free(&pk);
+void delete_JWTSigner(JWTSigner *signer){
+    if(signer == NULL){
         return;
     }
-    ESP_LOGI(TAG, "Signing started");
-
-    size_t sig_len;
+    mbedtls_pk_free(&signer->pk);
+    mbedtls_ctr_drbg_free(&signer->ctr_drbg);
+    mbedtls_entropy_free(&signer->entropy);
+    memFree(signer);
+}
 
-    myConfig->jwt_components.signature = CREATE_CHAR_BUFFER(MBEDTLS_MPI_MAX_SIZE);
-    if (myConfig->jwt_components.signature == NULL) {
-        ESP_LOGE(TAG,"Can allocate memmory for signature"); 
-        return;    
+esp_err_t jwt_signer_sign(JWTSigner *signer, const unsigned char *hash, size_t hash_len,
+                          unsigned char *signature, size_t signature_size, size_t *signature_len){
+    if(signer == NULL || hash == NULL || signature == NULL || signature_len == NULL){
+        return ESP_ERR_INVALID_ARG;
     }
+    int64_t start = esp_timer_get_time();
+    if(mbedtls_error_log(mbedtls_pk_sign(&signer->pk, MBEDTLS_MD_SHA256, hash, hash_len, signature,
+                               signature_size, signature_len, mbedtls_ctr_drbg_random, &signer->ctr_drbg))<0){
+        return ESP_FAIL;
+    }
+    signer->last_sign_us = esp_timer_get_time() - start;
+    signer->total_sign_us += signer->last_sign_us;
+    signer->signatures++;
+    ESP_LOGI(TAG, "JWT signed in %lld us (average %lld us over %lu signatures)", (long long)signer->last_sign_us,
+             (long long)(signer->total_sign_us / signer->signatures), (unsigned long)signer->signatures);
+    return ESP_OK;
+}
+
+void sign_jwt(JWTConfig *myConfig){
+    JWTComponents *jwt = &myConfig->jwt_components;
+    size_t sig_len;
 
-    if(mbedtls_error_log(mbedtls_pk_sign(&pk, MBEDTLS_MD_SHA256, (const unsigned char *)myConfig->jwt_components.hash,
-                               myConfig->hashSize,  (unsigned char *)myConfig->jwt_components.signature,
-                               myConfig->signatureSize,&sig_len, mbedtls_ctr_drbg_random, &ctr_drbg))<0){
-        free(myConfig->jwt_components.signature);  
-        mbedtls_pk_free(&pk);       
+    ESP_LOGI(TAG, "Signing started");
+    // The raw claims are already encoded, so the scratch area takes the signature.
+    if(jwt_signer_sign(myConfig->signer, jwt->hash, sizeof(jwt->hash),
+                       (unsigned char *)jwt->scratch, jwt->scratch_size, &sig_len) != ESP_OK){
+        myConfig->step = step_jwt_encoded_genrate_header;
         return;
     }
-    
-    mbedtls_pk_free(&pk);
-    myConfig->jwt_components.encSignature = base64encodeUrl((unsigned char *)myConfig->jwt_components.signature,myConfig->signatureSize);
-    free(myConfig->jwt_components.signature);
-    concatStrings(&myConfig->jwt_components.jwt,myConfig->jwt_components.encSignature);
-    free(myConfig->jwt_components.encSignature);
+
+    jwt->jwt[jwt->jwt_len++] = '.';
+    jwt->jwt_len += jwt_encode_url(jwt, (unsigned char *)jwt->scratch, sig_len);
     myConfig->step = step_exchangeJwtForAccessToken;
 }
 
 
 static esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
     JWTConfig *myConfig = (JWTConfig *)evt->user_data;
-    static int total_len = 0;
-    static char *response_data = NULL;
+    StrBuilder *response_body = &myConfig->response_body;
+    httpTraceEvent(&myConfig->trace, evt->event_id);
     
     switch (evt->event_id) {
        case HTTP_EVENT_ERROR:
@@ -347,45 +288,18 @@ static esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
             ESP_LOGI(TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
             break;
         case HTTP_EVENT_ON_DATA:
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                char *response = (char *)malloc(evt->data_len + 1);
-                if(response == NULL){
-                    ESP_LOGE(TAG, "Failed to allocate memory for response");
-                    free(response);
-                    return ESP_FAIL; 
-                }
-                memcpy(response, evt->data, evt->data_len);
-                response[evt->data_len] = 0;
-                ESP_LOGI(TAG, "HTTP Response: %s", response);
-                free(response);
-            }else{
-                if (response_data == NULL) {
-                    response_data = malloc(evt->data_len + 1);
-                    if (response_data == NULL) {
-                        ESP_LOGE(TAG, "Failed to allocate memory for response");
-                        return ESP_FAIL;
-                    }
-                    memcpy(response_data, evt->data, evt->data_len);
-                } else {
-                    char *temp = realloc(response_data, total_len + evt->data_len + 1);
-                    if (temp == NULL) {
-                        ESP_LOGE(TAG, "Failed to allocate memory for response");
-                        free(response_data);
-                        return ESP_FAIL;
-                    }
-                    response_data = temp;
-                    memcpy(response_data + total_len, evt->data, evt->data_len);
-                }
-                total_len += evt->data_len;
-                response_data[total_len] = 0; 
-                ESP_LOGI(TAG, "Total responce length : %d",total_len);
+            // Chunked or not, the body is accumulated and parsed on disconnect.
+            if(!strBuilderAppend(response_body, (const char *)evt->data, evt->data_len)){
+                strBuilderFree(response_body);
+                return ESP_FAIL;
             }
+            ESP_LOGI(TAG, "Total responce length : %u", (unsigned)response_body->len);
             break;
         case HTTP_EVENT_DISCONNECTED:
            ESP_LOGI(TAG, "HTTP_EVENT_DISCONNETED");
-           if (response_data != NULL) {
-                //ESP_LOGI(TAG, "Response: %s", response_data);
-                cJSON *json_response = cJSON_Parse(response_data);
+           if (response_body->len > 0) {
+                //ESP_LOGI(TAG, "Response: %s", response_body->buf);
+                cJSON *json_response = cJSON_Parse(response_body->buf);
                 if (json_response == NULL) {
                     ESP_LOGE(TAG, "Failed to parse JSON response");
                     myConfig->token_error = true;
@@ -394,25 +308,31 @@ static esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
                     if (nameItem != NULL && cJSON_IsString(nameItem)) {
                         char *token = cJSON_GetStringValue(nameItem);
                         size_t len = strlen(token);
-                        myConfig->Access_Token = (char *)malloc(sizeof(char)*len + 1);
+                        memFree(myConfig->Access_Token);
+                        myConfig->Access_Token = (char *)memAlloc(sizeof(char)*len + 1);
                         if (myConfig->Access_Token == NULL) {
                             ESP_LOGE(TAG, "Failed to allocate memory for response");
-                            free(response_data);
+                            myConfig->token_error = true;
+                            strBuilderFree(response_body);
                             cJSON_Delete(json_response);
                             return ESP_FAIL;
                         }
                         strcpy( myConfig->Access_Token,token);
                         ESP_LOGI(TAG, "Acces Token parsed");
+                        cJSON *expiresItem = cJSON_GetObjectItem(json_response, esp_signer_gauth_pgm_str_19);
+                        int expires_in = cJSON_IsNumber(expiresItem) ? expiresItem->valueint : JWT_TOKEN_LIFETIME_S;
+                        myConfig->token_expiry = time(NULL) + expires_in;
+                        ESP_LOGI(TAG, "Access token expires in %d s", expires_in);
+                        myConfig->token_ready = true;
                     } else {
                         ESP_LOGE(TAG, "Can't find access_token item");
+                        myConfig->token_error = true;
                     }
                     cJSON_Delete(json_response);
-                    myConfig->token_ready = true;
                     ESP_LOGI(TAG, "Token parsed");
                 }
-                free(response_data);
-                response_data = NULL;
-                total_len = 0;
+                // The token response is read once per refresh, so its memory is released here.
+                strBuilderFree(response_body);
             }else{
                 myConfig->token_error = true;
             }
@@ -437,18 +357,20 @@ void exchangeJwtForAccessToken(JWTConfig *myConfig) {
         .user_data = myConfig
     };
     esp_http_client_handle_t client = esp_http_client_init(&config);
-    char post_data[1024];
-    snprintf(post_data, sizeof(post_data), 
-             "grant_type=urn:ietf:params:oauth:grant-type:jwt-bearer&assertion=%s", myConfig->jwt_components.jwt);
-
-    //ESP_LOGI(TAG, "Http POST DATA:%s",post_data);
+    // The form prefix sits right before the JWT, so the buffer is the body.
+    const char *post_data = myConfig->jwt_components.buffer;
+    size_t post_len = sizeof(JWT_ASSERTION_PREFIX) - 1 + myConfig->jwt_components.jwt_len;
 
     esp_http_client_set_method(client, HTTP_METHOD_POST);
-    esp_http_client_set_post_field(client, post_data, strlen(post_data));
+    esp_http_client_set_post_field(client, post_data, post_len);
     esp_http_client_set_header(client, "Content-Type", "application/x-www-form-urlencoded");
 
     ESP_LOGI(TAG,"HTTP POST request...");    
 
+    // The body of this exchange is collected in myConfig, so tokens for
+    // several configs can be fetched at the same time.
+    strBuilderReset(&myConfig->response_body);
+    httpTraceBegin(&myConfig->trace);
     esp_err_t err = esp_http_client_perform(client);
 
     if (err != ESP_OK) {  
@@ -458,11 +380,138 @@ void exchangeJwtForAccessToken(JWTConfig *myConfig) {
     esp_http_client_cleanup(client);
     
     if(err != ESP_OK){
-        free(myConfig->jwt_components.jwt);
+        httpTraceEnd(&myConfig->trace, HTTP_TRACE_TOKEN, err);
+        myConfig->step = step_jwt_encoded_genrate_header;
         return;
     }
     while(!((myConfig->token_ready) | (myConfig->token_error)));
-    free(myConfig->jwt_components.jwt);
-    myConfig->step = step_valid_token_generated;
+    httpTraceEnd(&myConfig->trace, HTTP_TRACE_TOKEN, myConfig->token_ready ? ESP_OK : ESP_ERR_INVALID_RESPONSE);
+    // A rejected assertion has to be signed again from the start.
+    myConfig->step = myConfig->token_ready ? step_valid_token_generated : step_jwt_encoded_genrate_header;
+}
+
+void jwt_sync_time(JWTConfig *myConfig){
+    if(!myConfig->time_sync_finished){
+        getTime();
+        myConfig->time_sync_finished = true;
+    }
 }
 
+static esp_err_t generate_access_token(JWTConfig *myConfig){
+    if(myConfig == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    myConfig->token_ready = false;
+    myConfig->token_error = false;
+    myConfig->step = step_jwt_encoded_genrate_header;
+
+    int steps = 0;
+    while(myConfig->step != step_valid_token_generated){
+        // Every step either advances or restarts the sequence, so a bounded
+        // number of calls means repeated failures rather than slow progress.
+        if(++steps > JWT_GENERATE_MAX_STEPS){
+            ESP_LOGE(TAG, "Token generation failed");
+            return ESP_FAIL;
+        }
+        switch (myConfig->step)
+        {
+            case step_jwt_encoded_genrate_header:
+                jwt_encoded_genrate_header(myConfig);
+            break;
+            case step_jwt_encoded_genrate_payload:
+                jwt_encoded_genrate_payload(myConfig);
+            break;
+            case step_jwt_gen_hash:
+                jwt_gen_hash(myConfig);
+            break;
+            case step_sign_jwt:
+                sign_jwt(myConfig);
+            break;
+            case step_exchangeJwtForAccessToken:
+                myConfig->token_ready = false;
+                myConfig->token_error = false;
+                exchangeJwtForAccessToken(myConfig);
+            break;
+            case step_valid_token_generated:
+                ;
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t jwt_generate_access_token(JWTConfig *myConfig){
+    MemScope scope;
+    memScopeBegin(&scope, HTTP_TRACE_TOKEN);
+    esp_err_t err = generate_access_token(myConfig);
+    memScopeEnd(&scope);
+    return err;
+}
+
+
+#if CONFIG_JWT_BENCHMARK
+#include "micro_bench.h"
+
+/*
+ * Times every step of building a signed JWT on its own, without the token
+ * exchange. Before each round the JWT is cut back to where the previous
+ * step left it, so every round does the same work. Time is not synced, the
+ * claims carry whatever the clock says. Signing is slow, so the key setup
+ * and the signature run sign_rounds times.
+ */
+void jwtBenchmark(const char *private_key, const char *client_email, int rounds, int sign_rounds){
+    JWTConfig *myConfig = new_JWTConfig();
+    if(myConfig == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory for JWTConfig");
+        return;
+    }
+    myConfig->private_key = private_key;
+    myConfig->client_email = client_email;
+    myConfig->time_sync_finished = true;
+    JWTComponents *jwt = &myConfig->jwt_components;
+    MicroBench bench;
+
+    microBenchBegin(&bench, "jwt signer setup", sign_rounds);
+    for(int i = 0; i < sign_rounds; i++){
+        delete_JWTSigner(new_JWTSigner(private_key));
+    }
+    microBenchEnd(&bench);
+
+    // The first call creates the signer and the buffer, which is not what is measured.
+    jwt_encoded_genrate_header(myConfig);
+    if(myConfig->step != step_jwt_encoded_genrate_payload){
+        ESP_LOGE(TAG, "JWT benchmark setup failed");
+        delete_JWTConfig(myConfig);
+        return;
+    }
+    microBenchBegin(&bench, "jwt header", rounds);
+    for(int i = 0; i < rounds; i++){
+        jwt_encoded_genrate_header(myConfig);
+    }
+    microBenchEnd(&bench);
+
+    microBenchBegin(&bench, "jwt payload", rounds);
+    for(int i = 0; i < rounds; i++){
+        jwt->jwt_len = sizeof(JWT_ENCODED_HEADER);
+        jwt_encoded_genrate_payload(myConfig);
+    }
+    microBenchEnd(&bench);
+
+    microBenchBegin(&bench, "jwt hash", rounds);
+    for(int i = 0; i < rounds; i++){
+        jwt_gen_hash(myConfig);
+    }
+    microBenchEnd(&bench);
+
+    microBenchBegin(&bench, "jwt sign", sign_rounds);
+    for(int i = 0; i < sign_rounds; i++){
+        jwt->jwt_len = jwt->signing_len;
+        sign_jwt(myConfig);
+    }
+    microBenchEnd(&bench);
+    if(myConfig->step != step_exchangeJwtForAccessToken){
+        ESP_LOGE(TAG, "JWT signing failed");
+    }
+    delete_JWTConfig(myConfig);
+}
+#endif
@@ -31,13 +31,24 @@
 #include "esp_err.h"
 #include "esp_http_client.h"
 #include "cJSON.h"
+#include "str_builder.h"
+#include "http_trace.h"
+#include "mem_alloc.h"
+#include "sdkconfig.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
 
-#define MBEDTLS_BASE64_ENCODE_OUTPUT(len) ((((len) + 2) / 3 * 4) + 1)
-#define CREATE_CHAR_BUFFER(size) ((char *)malloc(size)) 
+#define CREATE_CHAR_BUFFER(size) ((char *)memAlloc(size)) 
 #define ERROR_BUFFER_SIZE 100
-
-static const char base64EncBuffUrl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
-static const char base64EncBuffData[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+#define JWT_TOKEN_LIFETIME_S 3600
+#define JWT_GENERATE_MAX_STEPS 30
+#define JWT_HASH_SIZE 32
+#define JWT_TIME_DIGITS 20
+// base64url of {"alg":"RS256","typ":"JWT"}
+#define JWT_ENCODED_HEADER "eyJhbGciOiJSUzI1NiIsInR5cCI6IkpXVCJ9"
+#define JWT_CLAIMS_FORMAT "{\"iss\":\"%s\",\"sub\":\"%s\",\"aud\":\"%s\",\"iat\":%lld,\"exp\":%lld,\"scope\":\"%s\"}"
+#define JWT_ASSERTION_PREFIX "grant_type=urn:ietf:params:oauth:grant-type:jwt-bearer&assertion="
 
 static const char googleapis_auth_url[] = "https://www.googleapis.com/oauth2/v4/token";
 static const char googleapis_auth2_url[] = "https://oauth2.googleapis.com/token";
@@ -145,44 +156,64 @@ typedef enum{
 }jwt_generation_steps;
 
 typedef struct{
-    char *header;
-    char *payload;
-    char *encHeader;
-    char *encPayload;
-    char *encHeadPayload;
-    char *encSignature;
-    char *signature;
+    char *buffer;
+    size_t buffer_size;
     char *jwt;
-    char *hash;
+    size_t jwt_len;
+    size_t signing_len;
+    char *scratch;
+    size_t scratch_size;
+    unsigned char hash[JWT_HASH_SIZE];
 }JWTComponents;
 
+/*
+ * Parsed private key and seeded CTR_DRBG, set up once and reused for every
+ * signature. Sign times are measured so refresh cost stays visible.
+ */
+typedef struct JWTSigner{
+    mbedtls_pk_context pk;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    int64_t setup_us;
+    int64_t last_sign_us;
+    int64_t total_sign_us;
+    uint32_t signatures;
+}JWTSigner;
+
 typedef struct JWTConfig{
     JWTComponents jwt_components;
+    JWTSigner *signer;
     bool token_ready;
     bool token_error;
     bool time_sync_finished;
     const char *private_key;
     const char *client_email;
-    const char *Access_Token;
-    size_t signatureSize;
-    size_t hashSize;
+    char *Access_Token;
+    time_t token_expiry;
+    StrBuilder response_body;
+    HttpTrace trace;
     void (*init_JWT_Auth)(struct JWTConfig*);
     jwt_generation_steps step;
 } JWTConfig;
 
 static void init_JWT_Auth(JWTConfig *myConfig);
-bool concatStrings(char **str1, char *str2);
 JWTConfig *new_JWTConfig();
+void delete_JWTConfig(JWTConfig *myConfig);
 void exchangeJwtForAccessToken(JWTConfig *myConfig);
 void jwt_encoded_genrate_header(JWTConfig *myConfig);
 void jwt_encoded_genrate_payload(JWTConfig *myConfig);
 void jwt_gen_hash(JWTConfig *myConfig);
 void sign_jwt(JWTConfig *myConfig);
+JWTSigner *new_JWTSigner(const char *private_key);
+void delete_JWTSigner(JWTSigner *signer);
+esp_err_t jwt_signer_sign(JWTSigner *signer, const unsigned char *hash, size_t hash_len,
+                          unsigned char *signature, size_t signature_size, size_t *signature_len);
+void jwt_sync_time(JWTConfig *myConfig);
+esp_err_t jwt_generate_access_token(JWTConfig *myConfig);
+#if CONFIG_JWT_BENCHMARK
+void jwtBenchmark(const char *private_key, const char *client_email, int rounds, int sign_rounds);
+#endif
 static time_t getTime();
-static bool encodeBase64(char *encoded, unsigned char *string, size_t len,char *base64EncBuff);
 static esp_err_t _http_event_handler(esp_http_client_event_t *evt);
 static int mbedtls_error_log(int error);
-char * base64encodeUrl(unsigned char *input, size_t length);
-static char* base64_encode(unsigned char *input, size_t length,bool url);
-char * base64encodeData(unsigned char *input, size_t length);
 #endif 
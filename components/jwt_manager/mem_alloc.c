@@ -0,0 +1,258 @@
+/**
+ * mem_alloc.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "mem_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+
+static const MemAllocator *allocator;
+
+#if CONFIG_MEM_ACCOUNTING
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+
+static const char *TAG = "MemAlloc";
+
+static __thread MemScope *current_scope;
+static MemOpStats op_stats[HTTP_TRACE_OP_COUNT];
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+void memSetAllocator(const MemAllocator *custom){
+    allocator = custom;
+}
+
+static void *raw_malloc(size_t size){
+    return allocator != NULL ? allocator->malloc_fn(size, allocator->ctx) : malloc(size);
+}
+
+static void *raw_calloc(size_t n, size_t size){
+    return allocator != NULL ? allocator->calloc_fn(n, size, allocator->ctx) : calloc(n, size);
+}
+
+static void *raw_realloc(void *ptr, size_t size){
+    return allocator != NULL ? allocator->realloc_fn(ptr, size, allocator->ctx) : realloc(ptr, size);
+}
+
+static void raw_free(void *ptr){
+    if(allocator != NULL){
+        allocator->free_fn(ptr, allocator->ctx);
+    }else{
+        free(ptr);
+    }
+}
+
+#if CONFIG_MEM_ACCOUNTING
+static size_t block_size(void *ptr){
+    if(allocator == NULL){
+        return heap_caps_get_allocated_size(ptr);
+    }
+    return allocator->size_fn != NULL ? allocator->size_fn(ptr, allocator->ctx) : 0;
+}
+
+static void scope_add(MemScope *scope, void *ptr, size_t size, void *caller){
+    size_t usable = block_size(ptr);
+    if(usable == 0){
+        usable = size;
+    }
+    scope->allocs++;
+    scope->bytes += size;
+    scope->live += usable;
+    if(scope->live > scope->peak){
+        scope->peak = scope->live;
+    }
+#if CONFIG_MEM_ACCOUNTING_DEBUG
+    for(int i = 0; i < CONFIG_MEM_ACCOUNTING_DEBUG_BLOCKS; i++){
+        if(scope->blocks[i].ptr == NULL){
+            scope->blocks[i] = (MemBlock){ .ptr = ptr, .size = usable, .caller = caller };
+            return;
+        }
+    }
+    scope->untracked++;
+#endif
+}
+
+// Size charged for a block the scope is about to release.
+static size_t scope_size(MemScope *scope, void *ptr){
+#if CONFIG_MEM_ACCOUNTING_DEBUG
+    for(int i = 0; i < CONFIG_MEM_ACCOUNTING_DEBUG_BLOCKS; i++){
+        if(scope->blocks[i].ptr == ptr){
+            return scope->blocks[i].size;
+        }
+    }
+#endif
+    return block_size(ptr);
+}
+
+// Only compares the address, so it is safe once the block is gone.
+static void scope_release(MemScope *scope, void *ptr, size_t size){
+    scope->live -= size;
+#if CONFIG_MEM_ACCOUNTING_DEBUG
+    for(int i = 0; i < CONFIG_MEM_ACCOUNTING_DEBUG_BLOCKS; i++){
+        if(scope->blocks[i].ptr == ptr){
+            scope->blocks[i].ptr = NULL;
+            return;
+        }
+    }
+#endif
+}
+#endif
+
+void *memAlloc(size_t size){
+    void *ptr = raw_malloc(size);
+#if CONFIG_MEM_ACCOUNTING
+    if(current_scope != NULL && ptr != NULL){
+        scope_add(current_scope, ptr, size, __builtin_return_address(0));
+    }
+#endif
+    return ptr;
+}
+
+void *memCalloc(size_t n, size_t size){
+    void *ptr = raw_calloc(n, size);
+#if CONFIG_MEM_ACCOUNTING
+    if(current_scope != NULL && ptr != NULL){
+        scope_add(current_scope, ptr, n * size, __builtin_return_address(0));
+    }
+#endif
+    return ptr;
+}
+
+void *memRealloc(void *ptr, size_t size){
+#if CONFIG_MEM_ACCOUNTING
+    MemScope *scope = current_scope;
+    size_t old = scope != NULL && ptr != NULL ? scope_size(scope, ptr) : 0;
+    void *moved = raw_realloc(ptr, size);
+    if(scope != NULL && (moved != NULL || size == 0)){
+        if(ptr != NULL){
+            scope_release(scope, ptr, old);
+        }
+        if(moved != NULL){
+            scope_add(scope, moved, size, __builtin_return_address(0));
+        }
+    }
+    return moved;
+#else
+    return raw_realloc(ptr, size);
+#endif
+}
+
+void memFree(void *ptr){
+#if CONFIG_MEM_ACCOUNTING
+    if(current_scope != NULL && ptr != NULL){
+        scope_release(current_scope, ptr, scope_size(current_scope, ptr));
+    }
+#endif
+    raw_free(ptr);
+}
+
+char *memStrdup(const char *str){
+    size_t len = strlen(str) + 1;
+    char *copy = (char *)raw_malloc(len);
+    if(copy == NULL){
+        return NULL;
+    }
+#if CONFIG_MEM_ACCOUNTING
+    if(current_scope != NULL){
+        scope_add(current_scope, copy, len, __builtin_return_address(0));
+    }
+#endif
+    memcpy(copy, str, len);
+    return copy;
+}
+
+#if CONFIG_MEM_ACCOUNTING
+void memScopeBegin(MemScope *scope, http_trace_op_t op){
+    memset(scope, 0, sizeof(MemScope));
+    scope->op = op;
+    scope->outer = current_scope;
+    current_scope = scope;
+}
+
+void memScopeEnd(MemScope *scope){
+    current_scope = scope->outer;
+    uint32_t live_blocks = 0;
+#if CONFIG_MEM_ACCOUNTING_DEBUG
+    for(int i = 0; i < CONFIG_MEM_ACCOUNTING_DEBUG_BLOCKS; i++){
+        if(scope->blocks[i].ptr != NULL){
+            live_blocks++;
+            ESP_LOGW(TAG, "%s: %u bytes at %p still live, allocated from %p", httpTraceOpName(scope->op),
+                     (unsigned)scope->blocks[i].size, scope->blocks[i].ptr, scope->blocks[i].caller);
+        }
+    }
+    if(scope->untracked > 0){
+        ESP_LOGW(TAG, "%s: %lu allocations were not tracked, raise MEM_ACCOUNTING_DEBUG_BLOCKS",
+                 httpTraceOpName(scope->op), (unsigned long)scope->untracked);
+    }
+#endif
+    if(scope->op >= HTTP_TRACE_OP_COUNT){
+        return;
+    }
+    MemOpStats *stats = &op_stats[scope->op];
+    portENTER_CRITICAL(&stats_lock);
+    stats->operations++;
+    stats->allocs += scope->allocs;
+    stats->bytes += scope->bytes;
+    stats->last_allocs = scope->allocs;
+    stats->last_bytes = scope->bytes;
+    stats->last_peak = (uint32_t)scope->peak;
+    stats->last_live_blocks = live_blocks;
+    if(stats->last_peak > stats->max_peak){
+        stats->max_peak = stats->last_peak;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+esp_err_t memGetStats(http_trace_op_t op, MemOpStats *stats){
+    if(op >= HTTP_TRACE_OP_COUNT || stats == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&stats_lock);
+    *stats = op_stats[op];
+    portEXIT_CRITICAL(&stats_lock);
+    return ESP_OK;
+}
+
+void memResetStats(void){
+    portENTER_CRITICAL(&stats_lock);
+    memset(op_stats, 0, sizeof(op_stats));
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void memDumpStats(void){
+    MemOpStats stats;
+    for(int op = 0; op < HTTP_TRACE_OP_COUNT; op++){
+        if(memGetStats((http_trace_op_t)op, &stats) != ESP_OK || stats.operations == 0){
+            continue;
+        }
+        ESP_LOGI(TAG, "%-8s %6lu ops  %6.1f allocs/op  %8.0f B/op  peak last %lu B max %lu B",
+                 httpTraceOpName((http_trace_op_t)op), (unsigned long)stats.operations,
+                 (double)stats.allocs / stats.operations, (double)stats.bytes / stats.operations,
+                 (unsigned long)stats.last_peak, (unsigned long)stats.max_peak);
+    }
+}
+#endif
@@ -0,0 +1,118 @@
+/**
+ * mem_alloc.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef MEM_ALLOC_H
+#define MEM_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "http_trace.h"
+#include "sdkconfig.h"
+
+/*
+ * Every heap allocation of the PubSub and jwt_manager components goes
+ * through memAlloc() and friends, so one allocator can be plugged in for
+ * both, e.g. one that places buffers in PSRAM. size_fn is optional and
+ * reports the usable size of a block; without it freed memory is not
+ * subtracted from the live bytes. Buffers handed to the caller, like
+ * PushMessage.message_id, come from the same allocator: with a custom one
+ * release them with memFree(). cJSON and mbedtls allocate on their own.
+ */
+typedef struct{
+    void *(*malloc_fn)(size_t size, void *ctx);
+    void *(*calloc_fn)(size_t n, size_t size, void *ctx);
+    void *(*realloc_fn)(void *ptr, size_t size, void *ctx);
+    void (*free_fn)(void *ptr, void *ctx);
+    size_t (*size_fn)(void *ptr, void *ctx);
+    void *ctx;
+}MemAllocator;
+
+/* Call before any component object is created; NULL restores the heap. */
+void memSetAllocator(const MemAllocator *allocator);
+
+void *memAlloc(size_t size);
+void *memCalloc(size_t n, size_t size);
+void *memRealloc(void *ptr, size_t size);
+void memFree(void *ptr);
+char *memStrdup(const char *str);
+
+typedef struct{
+    uint32_t operations;
+    uint64_t allocs;
+    uint64_t bytes;
+    uint32_t last_allocs;
+    uint32_t last_bytes;
+    uint32_t last_peak;
+    uint32_t last_live_blocks;
+    uint32_t max_peak;
+}MemOpStats;
+
+#if CONFIG_MEM_ACCOUNTING
+typedef struct{
+    void *ptr;
+    size_t size;
+    void *caller;
+}MemBlock;
+
+/*
+ * Allocations made by the task between memScopeBegin() and memScopeEnd()
+ * are charged to op. The peak is the most memory the operation held on top
+ * of what was allocated when it began. With CONFIG_MEM_ACCOUNTING_DEBUG the
+ * scope remembers its blocks and memScopeEnd() logs those still live,
+ * which is either a leak or a buffer handed to the caller.
+ */
+typedef struct MemScope{
+    struct MemScope *outer;
+    http_trace_op_t op;
+    uint32_t allocs;
+    uint32_t bytes;
+    int64_t live;
+    int64_t peak;
+#if CONFIG_MEM_ACCOUNTING_DEBUG
+    MemBlock blocks[CONFIG_MEM_ACCOUNTING_DEBUG_BLOCKS];
+    uint32_t untracked;
+#endif
+}MemScope;
+
+void memScopeBegin(MemScope *scope, http_trace_op_t op);
+void memScopeEnd(MemScope *scope);
+esp_err_t memGetStats(http_trace_op_t op, MemOpStats *stats);
+void memResetStats(void);
+void memDumpStats(void);
+#else
+typedef struct MemScope{
+    char unused;
+}MemScope;
+
+static inline void memScopeBegin(MemScope *scope, http_trace_op_t op){ (void)scope; (void)op; }
+static inline void memScopeEnd(MemScope *scope){ (void)scope; }
+static inline esp_err_t memGetStats(http_trace_op_t op, MemOpStats *stats){ return ESP_ERR_NOT_SUPPORTED; }
+static inline void memResetStats(void){}
+static inline void memDumpStats(void){}
+#endif
+
+#endif // MEM_ALLOC_H
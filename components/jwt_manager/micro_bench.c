@@ -0,0 +1,99 @@
+/**
+ * micro_bench.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "micro_bench.h"
+
+#if MICRO_BENCH_ENABLED
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#if CONFIG_HEAP_USE_HOOKS
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#endif
+
+static const char *TAG = "MicroBench";
+
+#if CONFIG_HEAP_USE_HOOKS
+static volatile bool counting;
+static uint32_t alloc_count;
+static uint64_t alloc_bytes;
+static int64_t live_bytes;
+static int64_t peak_bytes;
+
+/*
+ * Called by the heap for every allocation and free once CONFIG_HEAP_USE_HOOKS
+ * is set, also while the flash cache is disabled, so both live in IRAM.
+ */
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps){
+    if(!counting || ptr == NULL){
+        return;
+    }
+    // Count the block as the free hook will see it, not the size asked for.
+    size_t usable = heap_caps_get_allocated_size(ptr);
+    alloc_count++;
+    alloc_bytes += usable;
+    live_bytes += usable;
+    if(live_bytes > peak_bytes){
+        peak_bytes = live_bytes;
+    }
+}
+
+void IRAM_ATTR esp_heap_trace_free_hook(void *ptr){
+    if(!counting || ptr == NULL){
+        return;
+    }
+    // Blocks from before the stage may be freed too; never go below where it began.
+    int64_t usable = (int64_t)heap_caps_get_allocated_size(ptr);
+    live_bytes = live_bytes > usable ? live_bytes - usable : 0;
+}
+#endif
+
+void microBenchBegin(MicroBench *bench, const char *name, int rounds){
+    bench->name = name;
+    bench->rounds = rounds > 0 ? rounds : 1;
+#if CONFIG_HEAP_USE_HOOKS
+    alloc_count = 0;
+    alloc_bytes = 0;
+    live_bytes = 0;
+    peak_bytes = 0;
+    counting = true;
+#endif
+    bench->start_us = esp_timer_get_time();
+}
+
+void microBenchEnd(MicroBench *bench){
+    int64_t us = esp_timer_get_time() - bench->start_us;
+#if CONFIG_HEAP_USE_HOOKS
+    counting = false;
+    ESP_LOGI(TAG, "%-24s %7d x %11.2f us/op %8.1f allocs/op %10.1f B/op  peak %lld B", bench->name,
+             bench->rounds, (double)us / bench->rounds, (double)alloc_count / bench->rounds,
+             (double)alloc_bytes / bench->rounds, (long long)peak_bytes);
+#else
+    ESP_LOGI(TAG, "%-24s %7d x %11.2f us/op", bench->name, bench->rounds, (double)us / bench->rounds);
+#endif
+}
+#endif
@@ -0,0 +1,56 @@
+/**
+ * micro_bench.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef MICRO_BENCH_H
+#define MICRO_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+
+#define MICRO_BENCH_ENABLED (CONFIG_BASE64_BENCHMARK || CONFIG_JWT_BENCHMARK || CONFIG_PUBSUB_BENCHMARK)
+
+#if MICRO_BENCH_ENABLED
+/*
+ * One timed stage of a benchmark: run the operation rounds times between
+ * microBenchBegin() and microBenchEnd(), which logs the time per op. With
+ * CONFIG_HEAP_USE_HOOKS the heap hooks also count the allocations made in
+ * between, from any task, so run benchmarks before Wi-Fi is started. The
+ * peak is the most memory the stage held on top of what was allocated
+ * when it began. Sizes are the usable size of each block, and freeing a
+ * block from before the stage does not take the count below zero.
+ */
+typedef struct{
+    const char *name;
+    int rounds;
+    int64_t start_us;
+}MicroBench;
+
+void microBenchBegin(MicroBench *bench, const char *name, int rounds);
+void microBenchEnd(MicroBench *bench);
+#endif
+
+#endif // MICRO_BENCH_H
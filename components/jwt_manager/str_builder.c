@@ -0,0 +1,121 @@
+/**
+ * str_builder.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "str_builder.h"
+#include "mem_alloc.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+
+static const char *TAG = "StrBuilder";
+
+void strBuilderInit(StrBuilder *sb){
+    memset(sb, 0, sizeof(StrBuilder));
+}
+
+void strBuilderFree(StrBuilder *sb){
+    memFree(sb->buf);
+    strBuilderInit(sb);
+}
+
+void strBuilderReset(StrBuilder *sb){
+    sb->len = 0;
+    sb->failed = false;
+    if(sb->buf != NULL){
+        sb->buf[0] = '\0';
+    }
+}
+
+bool strBuilderReserve(StrBuilder *sb, size_t extra){
+    size_t needed = sb->len + extra + 1;
+    if(needed <= sb->size){
+        return true;
+    }
+    size_t new_size = sb->size ? sb->size : STR_BUILDER_MIN_SIZE;
+    while(new_size < needed){
+        new_size *= 2;
+    }
+    char *temp = (char *)memRealloc(sb->buf, new_size);
+    if(temp == NULL){
+        ESP_LOGE(TAG, "Failed to grow string to %u bytes", (unsigned)new_size);
+        sb->failed = true;
+        return false;
+    }
+    sb->buf = temp;
+    sb->size = new_size;
+    return true;
+}
+
+bool strBuilderAppend(StrBuilder *sb, const char *str, size_t len){
+    if(str == NULL || !strBuilderReserve(sb, len)){
+        return false;
+    }
+    memcpy(sb->buf + sb->len, str, len);
+    sb->len += len;
+    sb->buf[sb->len] = '\0';
+    return true;
+}
+
+bool strBuilderAppendStr(StrBuilder *sb, const char *str){
+    if(str == NULL){
+        return false;
+    }
+    return strBuilderAppend(sb, str, strlen(str));
+}
+
+bool strBuilderAppendf(StrBuilder *sb, const char *fmt, ...){
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(sb->buf != NULL ? sb->buf + sb->len : NULL, sb->buf != NULL ? sb->size - sb->len : 0, fmt, args);
+    va_end(args);
+    if(len < 0){
+        sb->failed = true;
+        return false;
+    }
+    if(sb->buf == NULL || sb->len + len + 1 > sb->size){
+        // Did not fit: grow once to the exact size and format again.
+        if(!strBuilderReserve(sb, len)){
+            if(sb->buf != NULL){
+                sb->buf[sb->len] = '\0';
+            }
+            return false;
+        }
+        va_start(args, fmt);
+        vsnprintf(sb->buf + sb->len, sb->size - sb->len, fmt, args);
+        va_end(args);
+    }
+    sb->len += len;
+    return true;
+}
+
+void strBuilderTruncate(StrBuilder *sb, size_t len){
+    if(sb->buf != NULL && len < sb->len){
+        sb->len = len;
+        sb->buf[len] = '\0';
+    }
+}
@@ -0,0 +1,63 @@
+/**
+ * str_builder.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef STR_BUILDER_H
+#define STR_BUILDER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define STR_BUILDER_MIN_SIZE 64
+
+/*
+ * Growable string shared by the request builders. Capacity doubles, so a
+ * run of appends costs amortised O(1) each. The length is tracked, so
+ * nothing is strlen'd again. strBuilderReset() drops the contents of one
+ * request and keeps the memory for the next. strBuilderFree() releases it.
+ * After a failed append the builder keeps its old contents, and `failed`
+ * stays set until the next reset.
+ */
+typedef struct StrBuilder{
+    char *buf;
+    size_t len;
+    size_t size;
+    bool failed;
+}StrBuilder;
+
+void strBuilderInit(StrBuilder *sb);
+void strBuilderFree(StrBuilder *sb);
+void strBuilderReset(StrBuilder *sb);
+bool strBuilderReserve(StrBuilder *sb, size_t extra);
+bool strBuilderAppend(StrBuilder *sb, const char *str, size_t len);
+bool strBuilderAppendStr(StrBuilder *sb, const char *str);
+bool strBuilderAppendf(StrBuilder *sb, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void strBuilderTruncate(StrBuilder *sb, size_t len);
+
+static inline const char *strBuilderStr(const StrBuilder *sb){
+    return sb->buf != NULL ? sb->buf : "";
+}
+
+#endif // STR_BUILDER_H
@@ -0,0 +1,230 @@
+/**
+ * token_provider.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include "token_provider.h"
+#include "mem_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "TokenProvider";
+
+static bool token_usable(TokenProvider *provider, time_t expiry){
+    return expiry - (time_t)provider->refresh_margin_s > time(NULL);
+}
+
+static void store_token(TokenProvider *provider, const char *token, time_t expiry){
+    xSemaphoreTake(provider->lock, portMAX_DELAY);
+    memFree(provider->access_token);
+    provider->access_token = memStrdup(token);
+    provider->expiry = provider->access_token ? expiry : 0;
+    xSemaphoreGive(provider->lock);
+}
+
+#if CONFIG_JWT_TOKEN_NVS_PERSIST
+static bool load_from_nvs(TokenProvider *provider){
+    nvs_handle_t handle;
+    if(nvs_open(TOKEN_PROVIDER_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK){
+        return false;
+    }
+    bool loaded = false;
+    int64_t expiry = 0;
+    size_t len = 0;
+    if(nvs_get_i64(handle, "expiry", &expiry) == ESP_OK && token_usable(provider, (time_t)expiry) &&
+       nvs_get_str(handle, "token", NULL, &len) == ESP_OK){
+        char *token = (char *)memAlloc(len);
+        if(token != NULL && nvs_get_str(handle, "token", token, &len) == ESP_OK){
+            store_token(provider, token, (time_t)expiry);
+            loaded = provider->access_token != NULL;
+        }
+        memFree(token);
+    }
+    nvs_close(handle);
+    return loaded;
+}
+
+static void save_to_nvs(const char *token, time_t expiry){
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(TOKEN_PROVIDER_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if(err == ESP_OK){
+        err = nvs_set_str(handle, "token", token);
+        if(err == ESP_OK){
+            err = nvs_set_i64(handle, "expiry", (int64_t)expiry);
+        }
+        if(err == ESP_OK){
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if(err != ESP_OK){
+        ESP_LOGW(TAG, "Failed to persist token: %s", esp_err_to_name(err));
+    }
+}
+#endif
+
+static esp_err_t refresh_token(TokenProvider *provider){
+    int64_t start = (int64_t)time(NULL);
+    esp_err_t err = jwt_generate_access_token(provider->config);
+    if(err != ESP_OK){
+        return err;
+    }
+    store_token(provider, provider->config->Access_Token, provider->config->token_expiry);
+    if(provider->access_token == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+    provider->refreshes++;
+    ESP_LOGI(TAG, "Access token refreshed in %lld s", (long long)((int64_t)time(NULL) - start));
+#if CONFIG_JWT_TOKEN_NVS_PERSIST
+    save_to_nvs(provider->config->Access_Token, provider->config->token_expiry);
+#endif
+    return ESP_OK;
+}
+
+static void token_provider_task(void *arg){
+    TokenProvider *provider = (TokenProvider *)arg;
+
+    while(provider->running){
+        time_t refresh_at = tokenProviderGetExpiry(provider) - (time_t)provider->refresh_margin_s;
+        time_t now = time(NULL);
+        if(refresh_at > now){
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((uint32_t)(refresh_at - now) * 1000));
+            continue;
+        }
+        if(refresh_token(provider) != ESP_OK){
+            ESP_LOGE(TAG, "Token refresh failed, retrying in %d s", TOKEN_PROVIDER_RETRY_S);
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TOKEN_PROVIDER_RETRY_S * 1000));
+            continue;
+        }
+        if(provider->on_refresh != NULL){
+            provider->on_refresh(provider->config->Access_Token, provider->on_refresh_ctx);
+        }
+    }
+
+    xTaskNotifyGive(provider->stop_waiter);
+    vTaskDelete(NULL);
+}
+
+TokenProvider *new_TokenProvider(JWTConfig *config, uint32_t refresh_margin_s){
+    if(config == NULL){
+        return NULL;
+    }
+    TokenProvider *provider = (TokenProvider *)memCalloc(1, sizeof(TokenProvider));
+    if(provider == NULL){
+        ESP_LOGE(TAG, "Failed to allocate memory for TokenProvider");
+        return NULL;
+    }
+    provider->config = config;
+    provider->refresh_margin_s = refresh_margin_s ? refresh_margin_s : CONFIG_JWT_TOKEN_REFRESH_MARGIN_S;
+    provider->lock = xSemaphoreCreateMutex();
+    if(provider->lock == NULL){
+        memFree(provider);
+        return NULL;
+    }
+    return provider;
+}
+
+void delete_TokenProvider(TokenProvider *provider){
+    if(provider == NULL){
+        return;
+    }
+    if(provider->task != NULL){
+        provider->stop_waiter = xTaskGetCurrentTaskHandle();
+        provider->running = false;
+        xTaskNotifyGive(provider->task);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    vSemaphoreDelete(provider->lock);
+    memFree(provider->access_token);
+    memFree(provider);
+}
+
+/*
+ * Blocks until a valid token is available, from NVS or freshly generated,
+ * then starts the background refresh task.
+ */
+esp_err_t tokenProviderStart(TokenProvider *provider, token_refresh_callback_t on_refresh, void *ctx){
+    if(provider == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    provider->on_refresh = on_refresh;
+    provider->on_refresh_ctx = ctx;
+
+    // Expiry checks need wall-clock time, which is cheap next to signing.
+    jwt_sync_time(provider->config);
+
+#if CONFIG_JWT_TOKEN_NVS_PERSIST
+    provider->loaded_from_nvs = load_from_nvs(provider);
+    if(provider->loaded_from_nvs){
+        ESP_LOGI(TAG, "Reusing stored access token, valid for %lld s", (long long)(provider->expiry - time(NULL)));
+        memFree(provider->config->Access_Token);
+        provider->config->Access_Token = memStrdup(provider->access_token);
+        provider->config->token_expiry = provider->expiry;
+        provider->config->step = step_valid_token_generated;
+    }
+#endif
+    if(!provider->loaded_from_nvs){
+        esp_err_t err = refresh_token(provider);
+        if(err != ESP_OK){
+            return err;
+        }
+    }
+
+    provider->running = true;
+    if(xTaskCreate(token_provider_task, "jwt_refresh", CONFIG_JWT_TOKEN_PROVIDER_TASK_STACK_SIZE, provider,
+                   CONFIG_JWT_TOKEN_PROVIDER_TASK_PRIORITY, &provider->task) != pdPASS){
+        ESP_LOGE(TAG, "Failed to start token refresh task");
+        provider->running = false;
+        provider->task = NULL;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t tokenProviderGetToken(TokenProvider *provider, char *buf, size_t len){
+    if(provider == NULL || buf == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(provider->lock, portMAX_DELAY);
+    if(provider->access_token == NULL || provider->expiry <= time(NULL)){
+        err = ESP_ERR_INVALID_STATE;
+    }else if(strlen(provider->access_token) >= len){
+        err = ESP_ERR_INVALID_SIZE;
+    }else{
+        strcpy(buf, provider->access_token);
+    }
+    xSemaphoreGive(provider->lock);
+    return err;
+}
+
+time_t tokenProviderGetExpiry(TokenProvider *provider){
+    xSemaphoreTake(provider->lock, portMAX_DELAY);
+    time_t expiry = provider->expiry;
+    xSemaphoreGive(provider->lock);
+    return expiry;
+}
@@ -0,0 +1,71 @@
+/**
+ * token_provider.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef TOKEN_PROVIDER_H
+#define TOKEN_PROVIDER_H
+
+#include <time.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "jwt_manager.h"
+
+#define TOKEN_PROVIDER_NVS_NAMESPACE "jwt_token"
+#define TOKEN_PROVIDER_RETRY_S 30
+
+typedef void (*token_refresh_callback_t)(const char *access_token, void *ctx);
+
+/*
+ * Keeps a valid OAuth access token. On start it reuses a token persisted in
+ * NVS when it is still valid for longer than the refresh margin, so a warm
+ * boot needs neither an RSA signature nor a token exchange. A background
+ * task then signs and exchanges a new JWT refresh_margin_s before expiry,
+ * stores it in NVS and hands it to on_refresh (called from that task).
+ */
+typedef struct TokenProvider{
+    JWTConfig *config;
+    uint32_t refresh_margin_s;
+    SemaphoreHandle_t lock;
+    TaskHandle_t task;
+    TaskHandle_t stop_waiter;
+    volatile bool running;
+    char *access_token;
+    time_t expiry;
+    token_refresh_callback_t on_refresh;
+    void *on_refresh_ctx;
+    uint32_t refreshes;
+    bool loaded_from_nvs;
+}TokenProvider;
+
+TokenProvider *new_TokenProvider(JWTConfig *config, uint32_t refresh_margin_s);
+void delete_TokenProvider(TokenProvider *provider);
+esp_err_t tokenProviderStart(TokenProvider *provider, token_refresh_callback_t on_refresh, void *ctx);
+esp_err_t tokenProviderGetToken(TokenProvider *provider, char *buf, size_t len);
+time_t tokenProviderGetExpiry(TokenProvider *provider);
+
+#endif // TOKEN_PROVIDER_H
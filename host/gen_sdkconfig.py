@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+#
+# gen_sdkconfig.py
+#
+# Created on: 17.10.2026
+#
+# Copyright (c) 2026 Eugin Francis. All rights reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+"""Writes sdkconfig.h for the host build from the components' Kconfig defaults.
+
+Only the subset of Kconfig the components use is understood: bool, int and
+string options, their first unconditional default, `depends on` a single
+symbol, and choices. Lines of the form CONFIG_X=value in the overrides files
+win over the defaults, the same syntax as an ESP-IDF sdkconfig.defaults; later
+files win over earlier ones. Symbols of other ESP-IDF components, such as
+CONFIG_HEAP_USE_HOOKS, can be set there too.
+"""
+import argparse
+import re
+
+
+def parse_kconfig(path, values):
+    kind = {}
+    depends = {}
+    choice = None
+    current = None
+    with open(path) as f:
+        for raw in f:
+            line = raw.strip()
+            m = re.match(r'choice\s+(\w+)', line)
+            if m:
+                choice, current = m.group(1), None
+                continue
+            if line == 'endchoice':
+                choice = current = None
+                continue
+            m = re.match(r'config\s+(\w+)', line)
+            if m:
+                current = m.group(1)
+                continue
+            if choice is not None and current is None:
+                m = re.match(r'default\s+(\w+)$', line)
+                if m:
+                    values[m.group(1)] = 'y'
+                    kind[m.group(1)] = 'bool'
+                continue
+            if current is None:
+                continue
+            m = re.match(r'(bool|int|string)\b', line)
+            if m:
+                kind[current] = m.group(1)
+                values.setdefault(current, 'n' if m.group(1) == 'bool' else None)
+                continue
+            m = re.match(r'depends on\s+(\w+)$', line)
+            if m:
+                depends[current] = m.group(1)
+                continue
+            m = re.match(r'default\s+(.+)$', line)
+            if m and ' if ' not in m.group(1) and values.get(current) in (None, 'n'):
+                values[current] = m.group(1).strip()
+    return kind, depends
+
+
+def parse_overrides(path, values):
+    with open(path) as f:
+        for raw in f:
+            m = re.match(r'\s*CONFIG_(\w+)=(.*)$', raw)
+            if m:
+                values[m.group(1)] = m.group(2).strip()
+                continue
+            m = re.match(r'\s*#\s*CONFIG_(\w+) is not set', raw)
+            if m:
+                values[m.group(1)] = 'n'
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--out', required=True)
+    parser.add_argument('--overrides', action='append', default=[])
+    parser.add_argument('kconfig', nargs='+')
+    args = parser.parse_args()
+
+    values, kind, depends = {}, {}, {}
+    for path in args.kconfig:
+        k, d = parse_kconfig(path, values)
+        kind.update(k)
+        depends.update(d)
+    for path in args.overrides:
+        parse_overrides(path, values)
+
+    lines = ['/* Generated by gen_sdkconfig.py, do not edit. */', '#pragma once']
+    for name in sorted(kind):
+        value = values.get(name)
+        parent = depends.get(name)
+        if value is None or (parent is not None and values.get(parent) != 'y'):
+            continue
+        if kind[name] == 'bool':
+            if value == 'y':
+                lines.append('#define CONFIG_%s 1' % name)
+        else:
+            lines.append('#define CONFIG_%s %s' % (name, value))
+    for name in sorted(set(values) - set(kind)):
+        value = values[name]
+        if value == 'y':
+            lines.append('#define CONFIG_%s 1' % name)
+        elif value not in (None, 'n'):
+            lines.append('#define CONFIG_%s %s' % (name, value))
+    with open(args.out, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,345 @@
+#!/usr/bin/env python3
+#
+# mock_pubsub.py
+#
+# Created on: 17.10.2026
+#
+# Copyright (c) 2026 Eugin Francis. All rights reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+"""A local stand-in for Google Pub/Sub and its OAuth token endpoint.
+
+Implements just what the components call: the token exchange, :publish,
+:pull and :acknowledge, plus subscription creation (PUT), over plain
+HTTP/1.1 with keep-alive. State lives in
+memory. Responses are chunked by default, like the real service. Only the
+Python standard library is used.
+"""
+import argparse
+import base64
+import binascii
+import itertools
+import json
+import re
+import signal
+import sys
+import threading
+import time
+import urllib.parse
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+PUBLISH_RE = re.compile(r'^/v1/projects/([^/]+)/topics/([^/:]+):publish$')
+PULL_RE = re.compile(r'^/v1/projects/([^/]+)/subscriptions/([^/:]+):(pull|acknowledge)$')
+SUBSCRIPTION_RE = re.compile(r'^/v1/projects/([^/]+)/subscriptions/([^/:]+)$')
+TOPIC_RE = re.compile(r'^projects/([^/]+)/topics/([^/]+)$')
+TOKEN_PATHS = ('/oauth2/v4/token', '/token')
+JWT_BEARER = 'urn:ietf:params:oauth:grant-type:jwt-bearer'
+
+
+class ApiError(Exception):
+    STATUS = {400: 'INVALID_ARGUMENT', 401: 'UNAUTHENTICATED', 404: 'NOT_FOUND', 409: 'ALREADY_EXISTS',
+              411: 'LENGTH_REQUIRED'}
+
+    def __init__(self, code, message):
+        super().__init__(message)
+        self.code = code
+
+    def body(self):
+        return {'error': {'code': self.code, 'message': str(self), 'status': self.STATUS.get(self.code, 'UNKNOWN')}}
+
+
+def b64url_json(part):
+    return json.loads(base64.urlsafe_b64decode(part + '=' * (-len(part) % 4)))
+
+
+class Subscription:
+    def __init__(self, name):
+        self.name = name
+        self.messages = {}      # ackId -> [message, lease expiry]
+        self.order = []         # ackIds in publish order
+
+
+class State:
+    def __init__(self, args):
+        self.args = args
+        self.lock = threading.Lock()
+        self.ids = itertools.count(1)
+        self.tokens = set(args.token)
+        self.routes = {}        # (project, topic) -> [Subscription]
+        self.subscriptions = {} # (project, subscription) -> Subscription
+        self.unrouted = {}      # project -> [message] published before any subscription existed
+        self.stats = {'token': 0, 'publish': 0, 'published': 0, 'pull': 0, 'pulled': 0,
+                      'acknowledge': 0, 'acked': 0, 'errors': 0}
+        for spec in args.subscription:
+            name, _, topic = spec.partition('=')
+            project, _, sub = name.rpartition('/')
+            self.add_subscription(project or args.project, sub, [topic or sub])
+
+    def add_subscription(self, project, name, topics):
+        sub = self.subscriptions.get((project, name))
+        if sub is None:
+            sub = self.subscriptions[(project, name)] = Subscription(name)
+        for topic in topics:
+            self.routes.setdefault((project, topic), []).append(sub)
+        return sub
+
+    def subscription(self, project, name):
+        sub = self.subscriptions.get((project, name))
+        if sub is None:
+            # An unknown subscription receives everything published in its
+            # project, including what was published before it was first used.
+            topics = {t for (p, t) in self.routes if p == project}
+            sub = self.add_subscription(project, name, topics)
+            self.routes.setdefault((project, None), []).append(sub)
+            for msg in self.unrouted.pop(project, []):
+                self.deliver(sub, msg)
+        return sub
+
+    def deliver(self, sub, msg):
+        ack_id = 'ack-%s-%d' % (sub.name, next(self.ids))
+        sub.messages[ack_id] = [msg, 0.0]
+        sub.order.append(ack_id)
+
+    def publish(self, project, topic, messages):
+        ids = []
+        now = time.time()
+        for m in messages:
+            msg = {'data': m['data'], 'messageId': str(next(self.ids)),
+                   'publishTime': time.strftime('%Y-%m-%dT%H:%M:%S', time.gmtime(now)) + '.%06dZ' % (now % 1 * 1e6)}
+            if m.get('attributes'):
+                msg['attributes'] = m['attributes']
+            subs = self.routes.get((project, topic), []) + self.routes.get((project, None), [])
+            if subs:
+                for sub in dict.fromkeys(subs):
+                    self.deliver(sub, msg)
+            else:
+                self.unrouted.setdefault(project, []).append(msg)
+            ids.append(msg['messageId'])
+        return ids
+
+    def pull(self, sub, max_messages):
+        now = time.time()
+        out = []
+        for ack_id in sub.order:
+            if len(out) == max_messages:
+                break
+            entry = sub.messages.get(ack_id)
+            if entry is not None and entry[1] <= now:
+                entry[1] = now + self.args.ack_deadline
+                out.append({'ackId': ack_id, 'message': entry[0]})
+        sub.order = [a for a in sub.order if a in sub.messages]
+        return out
+
+    def acknowledge(self, sub, ack_ids):
+        acked = 0
+        for ack_id in ack_ids:
+            if sub.messages.pop(ack_id, None) is not None:
+                acked += 1
+        return acked
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'
+    disable_nagle_algorithm = True
+    server_version = 'MockPubSub/1.0'
+
+    def log_message(self, fmt, *args):
+        if not self.server.state.args.quiet:
+            sys.stderr.write('%s %s\n' % (self.address_string(), fmt % args))
+
+    def send_json(self, code, body):
+        args = self.server.state.args
+        data = json.dumps(body, separators=(',', ':')).encode()
+        self.send_response(code)
+        self.send_header('Content-Type', 'application/json; charset=UTF-8')
+        if args.content_length:
+            self.send_header('Content-Length', str(len(data)))
+            self.end_headers()
+            self.wfile.write(data)
+        else:
+            self.send_header('Transfer-Encoding', 'chunked')
+            self.end_headers()
+            for i in range(0, len(data), args.chunk_size):
+                piece = data[i:i + args.chunk_size]
+                self.wfile.write(b'%x\r\n%s\r\n' % (len(piece), piece))
+            self.wfile.write(b'0\r\n\r\n')
+        self.wfile.flush()
+
+    def read_body(self):
+        length = self.headers.get('Content-Length')
+        if length is None:
+            raise ApiError(411, 'Content-Length is required')
+        return self.rfile.read(int(length))
+
+    def check_auth(self, state):
+        if state.args.no_auth:
+            return
+        auth = self.headers.get('Authorization', '')
+        if not auth.startswith('Bearer ') or auth[7:] not in state.tokens:
+            raise ApiError(401, 'Request had invalid authentication credentials.')
+
+    def do_POST(self):
+        self.handle_request()
+
+    def do_PUT(self):
+        self.handle_request()
+
+    def handle_request(self):
+        state = self.server.state
+        self.requests = getattr(self, 'requests', 0) + 1
+        try:
+            body = self.read_body()
+            if state.args.latency_ms:
+                time.sleep(state.args.latency_ms / 1000.0)
+            path = urllib.parse.urlsplit(self.path).path
+            if self.command == 'PUT':
+                match = SUBSCRIPTION_RE.match(path)
+                if match is None:
+                    raise ApiError(404, 'Unknown path %s' % path)
+                self.check_auth(state)
+                self.send_json(200, self.create_subscription(state, match, body))
+            elif path in TOKEN_PATHS:
+                self.send_json(200, self.token(state, body))
+            elif PUBLISH_RE.match(path):
+                self.check_auth(state)
+                self.send_json(200, self.publish(state, PUBLISH_RE.match(path), body))
+            elif PULL_RE.match(path):
+                self.check_auth(state)
+                self.send_json(200, self.pull_or_ack(state, PULL_RE.match(path), body))
+            else:
+                raise ApiError(404, 'Unknown path %s' % path)
+        except ApiError as e:
+            with state.lock:
+                state.stats['errors'] += 1
+            self.send_json(e.code, e.body())
+        drop = state.args.drop_every
+        if drop and self.requests % drop == 0:
+            # Drop the connection without saying so, like an idle timeout.
+            self.close_connection = True
+
+    def token(self, state, body):
+        form = urllib.parse.parse_qs(body.decode())
+        if form.get('grant_type') != [JWT_BEARER] or len(form.get('assertion', [])) != 1:
+            raise ApiError(400, 'Invalid grant')
+        parts = form['assertion'][0].split('.')
+        try:
+            header, claims = b64url_json(parts[0]), b64url_json(parts[1])
+            base64.urlsafe_b64decode(parts[2] + '=' * (-len(parts[2]) % 4))
+        except (IndexError, ValueError, binascii.Error):
+            raise ApiError(400, 'Malformed JWT')
+        if len(parts) != 3 or header.get('alg') != 'RS256' or not parts[2]:
+            raise ApiError(400, 'Malformed JWT')
+        now = time.time()
+        if not all(k in claims for k in ('iss', 'aud', 'iat', 'exp')) or claims['exp'] < now:
+            raise ApiError(400, 'Invalid JWT claims')
+        with state.lock:
+            state.stats['token'] += 1
+            token = 'mock-token-%d' % next(state.ids)
+            state.tokens.add(token)
+        return {'access_token': token, 'expires_in': state.args.token_lifetime, 'token_type': 'Bearer'}
+
+    def create_subscription(self, state, match, body):
+        try:
+            topic = TOPIC_RE.match(json.loads(body)['topic'])
+        except (ValueError, KeyError, TypeError):
+            topic = None
+        if topic is None:
+            raise ApiError(400, 'Invalid subscription body')
+        project, name = match.group(1), match.group(2)
+        with state.lock:
+            if (project, name) in state.subscriptions:
+                raise ApiError(409, 'Subscription already exists')
+            state.add_subscription(project, name, [topic.group(2)])
+        return {'name': 'projects/%s/subscriptions/%s' % (project, name),
+                'topic': 'projects/%s/topics/%s' % topic.groups(),
+                'ackDeadlineSeconds': int(state.args.ack_deadline)}
+
+    def publish(self, state, match, body):
+        try:
+            messages = json.loads(body)['messages']
+            for m in messages:
+                base64.b64decode(m['data'], validate=True)
+                if not isinstance(m.get('attributes', {}), dict):
+                    raise ValueError
+        except (ValueError, KeyError, TypeError, binascii.Error):
+            raise ApiError(400, 'Invalid publish body')
+        if not messages:
+            raise ApiError(400, 'No messages')
+        with state.lock:
+            ids = state.publish(match.group(1), match.group(2), messages)
+            state.stats['publish'] += 1
+            state.stats['published'] += len(ids)
+        return {'messageIds': ids}
+
+    def pull_or_ack(self, state, match, body):
+        try:
+            request = json.loads(body)
+        except ValueError:
+            raise ApiError(400, 'Invalid JSON')
+        with state.lock:
+            sub = state.subscription(match.group(1), match.group(2))
+            if match.group(3) == 'pull':
+                received = state.pull(sub, int(request.get('maxMessages', 1)))
+                state.stats['pull'] += 1
+                state.stats['pulled'] += len(received)
+                return {'receivedMessages': received} if received else {}
+            state.stats['acknowledge'] += 1
+            state.stats['acked'] += state.acknowledge(sub, request.get('ackIds', []))
+            return {}
+
+
+def stop(signum, frame):
+    raise KeyboardInterrupt
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=8085)
+    parser.add_argument('--project', default='host-project', help='project for --subscription without one')
+    parser.add_argument('--subscription', action='append', default=[], metavar='[PROJECT/]SUB=TOPIC',
+                        help='route TOPIC to SUB; unknown subscriptions receive every topic of their project')
+    parser.add_argument('--token', action='append', default=['mock-token'], help='extra accepted access token')
+    parser.add_argument('--no-auth', action='store_true', help='accept requests without a valid token')
+    parser.add_argument('--token-lifetime', type=int, default=3600, help='expires_in of issued tokens')
+    parser.add_argument('--ack-deadline', type=float, default=10.0, help='seconds before redelivery')
+    parser.add_argument('--content-length', action='store_true', help='send Content-Length instead of chunks')
+    parser.add_argument('--chunk-size', type=int, default=512, help='bytes per response chunk')
+    parser.add_argument('--latency-ms', type=float, default=0, help='delay added to every response')
+    parser.add_argument('--drop-every', type=int, default=0, metavar='N',
+                        help='silently close each connection after N requests')
+    parser.add_argument('--quiet', action='store_true', help='no per-request log')
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer((args.host, args.port), Handler)
+    server.daemon_threads = True
+    server.state = State(args)
+    print('mock pubsub listening on %s:%d' % server.server_address[:2], flush=True)
+    signal.signal(signal.SIGTERM, stop)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        print('mock pubsub stats: %s' % json.dumps(server.state.stats), flush=True)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,125 @@
+/**
+ * pubsub_bench.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "base64_codec.h"
+#include "jwt_manager.h"
+#include "PubSub.h"
+
+/*
+ * Runs the component microbenchmarks on the host: base64, each JWT step
+ * and the publish/pull body handling, one line per stage with the time,
+ * allocations and bytes per op and the peak heap. The JWT stages need a
+ * PEM private key and are skipped without one.
+ */
+
+static void usage(const char *prog){
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --key FILE       PEM private key for the JWT stages\n"
+            "  --email ADDR     client email in the JWT claims\n"
+            "  --rounds N       rounds of the fast stages (default 10000)\n"
+            "  --sign-rounds N  rounds of key setup and signing (default 50)\n"
+            "  --messages N     messages per publish/pull stage (default 100000)\n"
+            "  --size N         base64 input size in bytes (default 1024)\n",
+            prog);
+}
+
+static char *read_file(const char *path){
+    FILE *f = fopen(path, "rb");
+    if(f == NULL){
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = (char *)malloc(len + 1);
+    if(buf != NULL && fread(buf, 1, len, f) == (size_t)len){
+        buf[len] = '\0';
+    }else{
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    return buf;
+}
+
+int main(int argc, char **argv){
+    const char *key_file = NULL;
+    const char *email = "bench@host-project.iam.gserviceaccount.com";
+    int rounds = 10000;
+    int sign_rounds = 50;
+    int messages = 100000;
+    int size = 1024;
+    static const struct option long_opts[] = {
+        {"key", required_argument, NULL, 'k'},
+        {"email", required_argument, NULL, 'e'},
+        {"rounds", required_argument, NULL, 'r'},
+        {"sign-rounds", required_argument, NULL, 's'},
+        {"messages", required_argument, NULL, 'n'},
+        {"size", required_argument, NULL, 'z'},
+        {"help", no_argument, NULL, 'h'},
+        {0},
+    };
+    int c;
+    while((c = getopt_long(argc, argv, "", long_opts, NULL)) != -1){
+        switch(c){
+            case 'k': key_file = optarg; break;
+            case 'e': email = optarg; break;
+            case 'r': rounds = atoi(optarg); break;
+            case 's': sign_rounds = atoi(optarg); break;
+            case 'n': messages = atoi(optarg); break;
+            case 'z': size = atoi(optarg); break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if(rounds <= 0 || sign_rounds <= 0 || messages <= 0 || size <= 0){
+        usage(argv[0]);
+        return 2;
+    }
+    esp_log_level_set("MicroBench", ESP_LOG_INFO);
+    esp_log_level_set("Base64", ESP_LOG_INFO);
+
+    base64Benchmark((size_t)size, rounds);
+
+    if(key_file != NULL){
+        char *key = read_file(key_file);
+        if(key == NULL){
+            fprintf(stderr, "cannot read %s\n", key_file);
+            return 1;
+        }
+        jwtBenchmark(key, email, rounds, sign_rounds);
+        free(key);
+    }else{
+        fprintf(stderr, "no --key, skipping the JWT stages\n");
+    }
+
+    pubsubBenchmark(messages);
+    return 0;
+}
@@ -0,0 +1,506 @@
+/**
+ * pubsub_e2e.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "host_shim.h"
+#include "jwt_manager.h"
+#include "PubSub.h"
+#include "PubSubAck.h"
+#include "PubSubRecvPool.h"
+
+/*
+ * End-to-end run against mock_pubsub.py, or anything else speaking the
+ * Pub/Sub REST API over plain HTTP: obtain a token, publish a numbered
+ * sequence of messages, pull and acknowledge them, and check that every
+ * payload came back exactly once and intact. Throughput and per-request
+ * latency are printed for each phase; the exit code is non-zero if any
+ * message was lost, duplicated or corrupted.
+ */
+
+static const char *TAG = "pubsub_e2e";
+
+static const PubSubAttribute e2e_attributes[] = { {"origin", "pubsub_e2e"} };
+
+typedef struct{
+    const char *server;
+    const char *key_file;
+    const char *email;
+    const char *token;
+    char *project;
+    char *topic;
+    char *subscription;
+    int messages;
+    int batch;
+    int size;
+    int pull_max;
+    bool binary;
+    bool stream;
+}E2EOptions;
+
+typedef struct{
+    int64_t *samples;
+    int count;
+    int64_t total_us;
+}Latency;
+
+typedef struct{
+    const E2EOptions *opts;
+    uint8_t *seen;
+    int received;
+    int duplicates;
+    int corrupt;
+    PubSubAcker *acker;
+    StrBuilder stream_acks;
+}PullCheck;
+
+static void latency_add(Latency *lat, int64_t us){
+    lat->samples[lat->count++] = us;
+    lat->total_us += us;
+}
+
+static int compare_i64(const void *a, const void *b){
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void latency_report(const char *what, Latency *lat, int messages, int64_t wall_us){
+    if(lat->count == 0){
+        printf("%-8s no requests\n", what);
+        return;
+    }
+    qsort(lat->samples, lat->count, sizeof(int64_t), compare_i64);
+    printf("%-8s %6d msgs %5d reqs %9.1f msgs/s  latency ms p50 %.2f p90 %.2f p99 %.2f max %.2f\n",
+           what, messages, lat->count, wall_us > 0 ? messages * 1e6 / wall_us : 0.0,
+           lat->samples[lat->count / 2] / 1000.0, lat->samples[lat->count * 9 / 10] / 1000.0,
+           lat->samples[lat->count * 99 / 100] / 1000.0, lat->samples[lat->count - 1] / 1000.0);
+}
+
+#if CONFIG_HTTP_TRACE
+// Where the request time went, from the component's own request tracing.
+static void trace_report(void){
+    HttpOpStats stats;
+    for(int op = 0; op < HTTP_TRACE_OP_COUNT; op++){
+        if(httpTraceGetStats((http_trace_op_t)op, &stats) != ESP_OK || stats.requests == 0){
+            continue;
+        }
+        for(int i = 0; i < HTTP_PHASE_COUNT; i++){
+            const HttpLatencyStats *p = &stats.phase[i];
+            if(p->count > 0){
+                printf("trace    %-8s %-8s %5lu reqs  ms p50 %.2f p95 %.2f p99 %.2f max %.2f\n",
+                       httpTraceOpName((http_trace_op_t)op), httpTracePhaseName((http_trace_phase_t)i), (unsigned long)p->count,
+                       p->p50_us / 1000.0, p->p95_us / 1000.0, p->p99_us / 1000.0, p->max_us / 1000.0);
+            }
+        }
+    }
+}
+#endif
+
+#if CONFIG_MEM_ACCOUNTING
+static void memory_report(void){
+    MemOpStats stats;
+    for(int op = 0; op < HTTP_TRACE_OP_COUNT; op++){
+        if(memGetStats((http_trace_op_t)op, &stats) != ESP_OK || stats.operations == 0){
+            continue;
+        }
+        printf("memory   %-8s %5lu ops  %.1f allocs/op  %.0f B/op  peak max %lu B\n",
+               httpTraceOpName((http_trace_op_t)op), (unsigned long)stats.operations,
+               (double)stats.allocs / stats.operations, (double)stats.bytes / stats.operations,
+               (unsigned long)stats.max_peak);
+    }
+}
+#endif
+
+// Payload of message seq: its number up front, then a pattern derived from it.
+static void fill_payload(const E2EOptions *opts, uint8_t *buf, uint32_t seq){
+    if(opts->binary){
+        memcpy(buf, &seq, sizeof(seq));
+        for(int i = sizeof(seq); i < opts->size; i++){
+            buf[i] = (uint8_t)(seq * 31 + i * 7);
+        }
+    }else{
+        snprintf((char *)buf, opts->size + 1, "%08lx", (unsigned long)seq);
+        for(int i = 8; i < opts->size; i++){
+            buf[i] = 'a' + (seq + i) % 26;
+        }
+        buf[opts->size] = '\0';
+    }
+}
+
+static void check_message(PullCheck *check, const char *arena, const Message *msg){
+    const E2EOptions *opts = check->opts;
+    const uint8_t *data = messageData(arena, msg);
+    uint8_t expected[opts->size + 1];
+    uint32_t seq = 0;
+    if(msg->data_len == (uint32_t)opts->size){
+        if(opts->binary){
+            memcpy(&seq, data, sizeof(seq));
+        }else{
+            char digits[9];
+            memcpy(digits, data, 8);
+            digits[8] = '\0';
+            seq = (uint32_t)strtoul(digits, NULL, 16);
+        }
+    }
+    if(msg->data_len != (uint32_t)opts->size || seq >= (uint32_t)opts->messages){
+        check->corrupt++;
+    }else{
+        fill_payload(opts, expected, seq);
+        if(memcmp(expected, data, opts->size) != 0){
+            check->corrupt++;
+        }else if(check->seen[seq]){
+            check->duplicates++;
+        }else{
+            check->seen[seq] = 1;
+            check->received++;
+        }
+    }
+    // An acknowledge cannot be sent while a streaming pull still owns the
+    // connection, so those ackIds are kept until the pull has returned.
+    if(opts->stream){
+        strBuilderAppend(&check->stream_acks, messageAckId(arena, msg), strlen(messageAckId(arena, msg)) + 1);
+    }else if(ackerAdd(check->acker, messageAckId(arena, msg)) != ESP_OK){
+        ESP_LOGE(TAG, "Failed to queue ack for %s", messageId(arena, msg));
+    }
+}
+
+static void ack_streamed(PullCheck *check){
+    for(size_t i = 0; i < check->stream_acks.len; i += strlen(check->stream_acks.buf + i) + 1){
+        if(ackerAdd(check->acker, check->stream_acks.buf + i) != ESP_OK){
+            ESP_LOGE(TAG, "Failed to queue ack for %s", check->stream_acks.buf + i);
+        }
+    }
+    strBuilderReset(&check->stream_acks);
+}
+
+static void on_stream_message(const char *arena, const Message *msg, void *ctx){
+    check_message((PullCheck *)ctx, arena, msg);
+}
+
+static char *read_file(const char *path){
+    FILE *f = fopen(path, "rb");
+    if(f == NULL){
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = (char *)malloc(len + 1);
+    if(buf != NULL && fread(buf, 1, len, f) == (size_t)len){
+        buf[len] = '\0';
+    }else{
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    return buf;
+}
+
+static char *obtain_token(const E2EOptions *opts){
+    if(opts->key_file == NULL){
+        return strdup(opts->token);
+    }
+    char *key = read_file(opts->key_file);
+    if(key == NULL){
+        ESP_LOGE(TAG, "Cannot read %s", opts->key_file);
+        return NULL;
+    }
+    JWTConfig *myConfig = new_JWTConfig();
+    char *token = NULL;
+    if(myConfig != NULL){
+        myConfig->init_JWT_Auth(myConfig);
+        myConfig->private_key = key;
+        myConfig->client_email = opts->email;
+        int64_t start = esp_timer_get_time();
+        if(jwt_generate_access_token(myConfig) == ESP_OK){
+            int64_t total = esp_timer_get_time() - start;
+            printf("token    %.2f ms total, key setup %.2f ms, sign %.2f ms\n", total / 1000.0,
+                   myConfig->signer->setup_us / 1000.0, myConfig->signer->last_sign_us / 1000.0);
+            token = strdup(myConfig->Access_Token);
+        }
+        delete_JWTConfig(myConfig);
+    }
+    free(key);
+    return token;
+}
+
+/*
+ * Creates the subscription on the topic, as subscriptions.create does on the
+ * real service, so it receives everything published from now on. An
+ * existing subscription (409) is fine.
+ */
+static esp_err_t create_subscription(const E2EOptions *opts, const char *token){
+    char url[PUBSUB_URL_SIZE], body[PUBSUB_URL_SIZE], auth[PUBSUB_URL_SIZE];
+    snprintf(url, sizeof(url), "https://pubsub.googleapis.com/v1/projects/%s/subscriptions/%s",
+             opts->project, opts->subscription);
+    snprintf(body, sizeof(body), "{\"topic\":\"projects/%s/topics/%s\"}", opts->project, opts->topic);
+    snprintf(auth, sizeof(auth), "Bearer %s", token);
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_PUT,
+        .timeout_ms = PUBSUB_HTTP_TIMEOUT_MS,
+    };
+    esp_http_client_handle_t http = esp_http_client_init(&config);
+    if(http == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+    esp_http_client_set_header(http, "Authorization", auth);
+    esp_http_client_set_header(http, "Content-Type", "application/json");
+    esp_http_client_set_post_field(http, body, strlen(body));
+    esp_err_t err = esp_http_client_perform(http);
+    int status = esp_http_client_get_status_code(http);
+    esp_http_client_cleanup(http);
+    if(err == ESP_OK && status != 200 && status != 409){
+        ESP_LOGE(TAG, "Creating subscription %s failed with HTTP %d", opts->subscription, status);
+        err = ESP_ERR_INVALID_RESPONSE;
+    }
+    return err;
+}
+
+static int publish_phase(const E2EOptions *opts, PubSubClient *client, PubSubTopic *topic){
+    PushMessage *msgs = (PushMessage *)calloc(opts->batch, sizeof(PushMessage));
+    PushMessage **batch = (PushMessage **)calloc(opts->batch, sizeof(PushMessage *));
+    uint8_t *payloads = (uint8_t *)malloc((size_t)opts->batch * (opts->size + 1));
+    Latency lat = { .samples = (int64_t *)calloc(opts->messages / opts->batch + 1, sizeof(int64_t)) };
+    int failed = 0;
+    if(msgs == NULL || batch == NULL || payloads == NULL || lat.samples == NULL){
+        ESP_LOGE(TAG, "Out of memory");
+        failed = opts->messages;
+    }
+    int64_t start = esp_timer_get_time();
+    for(int sent = 0; sent < opts->messages && failed == 0; sent += opts->batch){
+        int n = opts->messages - sent < opts->batch ? opts->messages - sent : opts->batch;
+        for(int i = 0; i < n; i++){
+            uint8_t *payload = payloads + (size_t)i * (opts->size + 1);
+            fill_payload(opts, payload, sent + i);
+            free(msgs[i].message_id);
+            pushMessageInit(&msgs[i], payload, opts->size, e2e_attributes, 1);
+            if(!opts->binary){
+                msgs[i].data = NULL;
+                msgs[i].message = (char *)payload;
+            }
+            batch[i] = &msgs[i];
+        }
+        int64_t t0 = esp_timer_get_time();
+        esp_err_t err = clientPostMessages(client, batch, n, topic);
+        latency_add(&lat, esp_timer_get_time() - t0);
+        for(int i = 0; i < n; i++){
+            if(err != ESP_OK || !msgs[i].posted_ok || msgs[i].message_id == NULL){
+                failed++;
+            }
+        }
+        if(err != ESP_OK){
+            ESP_LOGE(TAG, "Publish of messages %d..%d failed: %s", sent, sent + n - 1, esp_err_to_name(err));
+        }
+    }
+    latency_report("publish", &lat, opts->messages - failed, esp_timer_get_time() - start);
+    for(int i = 0; msgs != NULL && i < opts->batch; i++){
+        free(msgs[i].message_id);
+    }
+    free(lat.samples);
+    free(payloads);
+    free(batch);
+    free(msgs);
+    return failed;
+}
+
+static int pull_phase(const E2EOptions *opts, PubSubClient *client, PubSubTopic *topic){
+    PullCheck check = {
+        .opts = opts,
+        .seen = (uint8_t *)calloc(opts->messages, 1),
+        .acker = new_PubSubAcker(client, topic, 0, 0),
+    };
+    int max_pulls = opts->messages + 3;
+    Latency lat = { .samples = (int64_t *)calloc(max_pulls, sizeof(int64_t)) };
+    if(check.seen == NULL || check.acker == NULL || lat.samples == NULL){
+        ESP_LOGE(TAG, "Out of memory");
+        return opts->messages;
+    }
+    int empty = 0;
+    RecvPoolStats warm = {0};
+    int64_t start = esp_timer_get_time();
+    while(check.received < opts->messages && empty < 3 && lat.count < max_pulls){
+        PullMessage myPullMsg = {0};
+        int64_t t0 = esp_timer_get_time();
+        if(opts->stream){
+            clientStreamPullMessages(client, &myPullMsg, topic, on_stream_message, &check);
+        }else{
+            clientPullMessagesMax(client, &myPullMsg, topic, opts->pull_max);
+        }
+        latency_add(&lat, esp_timer_get_time() - t0);
+        for(int i = 0; !opts->stream && i < myPullMsg.msg_count; i++){
+            check_message(&check, myPullMsg.arena, &myPullMsg.message_array[i]);
+        }
+        if(myPullMsg.received_error){
+            ESP_LOGE(TAG, "Pull failed");
+        }
+        empty = myPullMsg.msg_count == 0 ? empty + 1 : 0;
+        freePullMessages(&myPullMsg);
+        ack_streamed(&check);
+        ackerFlushIfDue(check.acker);
+        if(lat.count == 1){
+            // The first pull sizes the buffers; after it the pool should cover every response.
+            warm = recvPoolGetStats();
+        }
+    }
+    ackerFlush(check.acker);
+    RecvPoolStats pool = recvPoolGetStats();
+    int pool_misses = (int)(pool.overflow - warm.overflow + pool.grown - warm.grown);
+    if(pool_misses != 0){
+        printf("rx pool  FAILED: %lu from the heap, %lu grown after the first pull"
+               " (a pull must fit PUBSUB_RECV_POOL_MAX_KEEP)\n",
+               (unsigned long)(pool.overflow - warm.overflow), (unsigned long)(pool.grown - warm.grown));
+    }
+    int64_t wall = esp_timer_get_time() - start;
+    latency_report("pull", &lat, check.received, wall);
+    printf("ack      %lu acked, %lu failed\n", (unsigned long)check.acker->acked, (unsigned long)check.acker->failed);
+    int missing = opts->messages - check.received;
+    if(missing != 0 || check.duplicates != 0 || check.corrupt != 0){
+        printf("verify   FAILED: %d missing, %d duplicates, %d corrupt\n", missing, check.duplicates, check.corrupt);
+    }else{
+        printf("verify   ok: %d messages round-tripped\n", check.received);
+    }
+    delete_PubSubAcker(check.acker);
+    strBuilderFree(&check.stream_acks);
+    free(lat.samples);
+    free(check.seen);
+    return missing + check.duplicates + check.corrupt + pool_misses;
+}
+
+static void usage(const char *prog){
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --server HOST:PORT     mock server (default $PUBSUB_HOST_SERVER or %s:%d)\n"
+            "  --key PEM --email ADDR sign a JWT and exchange it for a token\n"
+            "  --token TOKEN          use this access token instead (default mock-token)\n"
+            "  --project/--topic/--subscription NAME\n"
+            "  --messages N           messages to round-trip (default 1000)\n"
+            "  --batch N              messages per :publish (default 100)\n"
+            "  --size BYTES           payload size, at least 8 (default 64)\n"
+            "  --pull-max N           maxMessages per :pull (default 100)\n"
+            "  --binary               publish binary payloads instead of text\n"
+            "  --stream               use the streaming pull\n"
+            "  --verbose              log at info level\n",
+            prog, HOST_SHIM_DEFAULT_HOST, HOST_SHIM_DEFAULT_PORT);
+}
+
+int main(int argc, char **argv){
+    E2EOptions opts = {
+        .token = "mock-token",
+        .email = "e2e@host-project.iam.gserviceaccount.com",
+        .project = "host-project",
+        .topic = "host-topic",
+        .subscription = "host-sub",
+        .messages = 1000,
+        .batch = 100,
+        .size = 64,
+        .pull_max = 100,
+    };
+    static const struct option long_opts[] = {
+        {"server", required_argument, NULL, 's'},
+        {"key", required_argument, NULL, 'k'},
+        {"email", required_argument, NULL, 'e'},
+        {"token", required_argument, NULL, 't'},
+        {"project", required_argument, NULL, 'p'},
+        {"topic", required_argument, NULL, 'T'},
+        {"subscription", required_argument, NULL, 'S'},
+        {"messages", required_argument, NULL, 'n'},
+        {"batch", required_argument, NULL, 'b'},
+        {"size", required_argument, NULL, 'z'},
+        {"pull-max", required_argument, NULL, 'm'},
+        {"binary", no_argument, NULL, 'B'},
+        {"stream", no_argument, NULL, 'r'},
+        {"verbose", no_argument, NULL, 'v'},
+        {"help", no_argument, NULL, 'h'},
+        {0},
+    };
+    int c;
+    while((c = getopt_long(argc, argv, "", long_opts, NULL)) != -1){
+        switch(c){
+            case 's': opts.server = optarg; break;
+            case 'k': opts.key_file = optarg; break;
+            case 'e': opts.email = optarg; break;
+            case 't': opts.token = optarg; break;
+            case 'p': opts.project = optarg; break;
+            case 'T': opts.topic = optarg; break;
+            case 'S': opts.subscription = optarg; break;
+            case 'n': opts.messages = atoi(optarg); break;
+            case 'b': opts.batch = atoi(optarg); break;
+            case 'z': opts.size = atoi(optarg); break;
+            case 'm': opts.pull_max = atoi(optarg); break;
+            case 'B': opts.binary = true; break;
+            case 'r': opts.stream = true; break;
+            case 'v': esp_log_level_set("*", ESP_LOG_INFO); break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if(opts.messages <= 0 || opts.batch <= 0 || opts.size < 8 || opts.pull_max <= 0){
+        usage(argv[0]);
+        return 2;
+    }
+    if(opts.server != NULL && hostShimParseServer(opts.server) != ESP_OK){
+        fprintf(stderr, "invalid --server %s\n", opts.server);
+        return 2;
+    }
+
+    char *token = obtain_token(&opts);
+    if(token == NULL){
+        fprintf(stderr, "no access token\n");
+        return 1;
+    }
+    esp_err_t err = create_subscription(&opts, token);
+    PubSubClient *client = err == ESP_OK ? new_PubSubClient(token) : NULL;
+    free(token);
+    if(client == NULL){
+        return 1;
+    }
+    PubSubTopic topic = {
+        .topicName = opts.topic,
+        .projectId = opts.project,
+        .subscription_id = opts.subscription,
+    };
+    int failures = publish_phase(&opts, client, &topic);
+    failures += pull_phase(&opts, client, &topic);
+    printf("client   %lu requests on %lu connections, %lu reconnects\n", (unsigned long)client->stats.requests,
+           (unsigned long)client->stats.connections, (unsigned long)client->stats.reconnects);
+    RecvPoolStats pool = recvPoolGetStats();
+    printf("rx pool  %lu buffers taken: %lu reused, %lu allocated, %lu from the heap, %lu grown\n",
+           (unsigned long)pool.acquired, (unsigned long)pool.reused, (unsigned long)pool.allocated,
+           (unsigned long)pool.overflow, (unsigned long)pool.grown);
+#if CONFIG_HTTP_TRACE
+    trace_report();
+#endif
+#if CONFIG_MEM_ACCOUNTING
+    memory_report();
+#endif
+    delete_PubSubClient(client);
+    return failures == 0 ? 0 : 1;
+}
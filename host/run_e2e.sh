@@ -0,0 +1,69 @@
+#!/bin/sh
+#
+# run_e2e.sh
+#
+# Created on: 17.10.2026
+#
+# Copyright (c) 2026 Eugin Francis. All rights reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+# Starts mock_pubsub.py, runs pubsub_e2e against it and stops the mock.
+#   host/run_e2e.sh BUILD_DIR [pubsub_e2e options] [-- mock_pubsub.py options]
+# Unless --key is given, a throwaway RSA key is generated in BUILD_DIR, so the
+# run also signs a JWT and exchanges it at the mock's token endpoint.
+set -eu
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+BUILD=${1:?usage: run_e2e.sh BUILD_DIR [pubsub_e2e options] [-- mock options]}
+shift
+PORT=${PUBSUB_HOST_PORT:-8085}
+
+E2E_ARGS=""
+HAVE_KEY=0
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+    [ "$1" = "--key" ] && HAVE_KEY=1
+    E2E_ARGS="$E2E_ARGS $1"
+    shift
+done
+[ $# -gt 0 ] && shift
+
+if [ $HAVE_KEY -eq 0 ]; then
+    KEY="$BUILD/e2e_key.pem"
+    if [ ! -s "$KEY" ]; then
+        openssl genpkey -algorithm RSA -pkeyopt rsa_keygen_bits:2048 -out "$KEY" 2>/dev/null ||
+            { echo "openssl could not generate $KEY; pass --key" >&2; exit 1; }
+    fi
+    E2E_ARGS="$E2E_ARGS --key $KEY"
+fi
+
+python3 "$HERE/mock_pubsub.py" --quiet --port "$PORT" "$@" &
+MOCK=$!
+trap 'kill $MOCK 2>/dev/null; wait $MOCK 2>/dev/null || true' EXIT
+
+# Wait for the listening socket before the first request.
+i=0
+until python3 -c "import socket,sys; socket.create_connection(('127.0.0.1', $PORT), 1)" 2>/dev/null; do
+    i=$((i + 1))
+    [ $i -lt 50 ] || { echo "mock server did not start" >&2; exit 1; }
+    sleep 0.1
+done
+
+# shellcheck disable=SC2086
+"$BUILD/pubsub_e2e" --server "127.0.0.1:$PORT" $E2E_ARGS
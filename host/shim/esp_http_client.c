@@ -0,0 +1,592 @@
+/**
+ * esp_http_client.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "host_shim.h"
+
+#define HTTP_SHIM_DEFAULT_TIMEOUT_MS 5000
+#define HTTP_SHIM_DEFAULT_BUFFER_SIZE 512
+#define HTTP_SHIM_HOST_SIZE 128
+#define HTTP_SHIM_MAX_HEADERS 16
+#define HTTP_SHIM_LINE_SIZE 1024
+#define HTTP_SHIM_RX_SIZE 4096
+
+static const char *TAG = "HTTP_CLIENT";
+
+static const char *method_names[HTTP_METHOD_MAX] = { "GET", "POST", "PUT", "PATCH", "DELETE", "HEAD" };
+
+typedef struct{
+    char *key;
+    char *value;
+}HttpHeader;
+
+struct esp_http_client{
+    esp_http_client_config_t config;
+    esp_http_client_method_t method;
+    char host[HTTP_SHIM_HOST_SIZE];
+    char *path;
+    HttpHeader headers[HTTP_SHIM_MAX_HEADERS];
+    const char *post_data;
+    int post_len;
+    int fd;
+    // Response state.
+    int status_code;
+    int64_t content_length;
+    int64_t body_left;
+    bool chunked;
+    bool connection_close;
+    bool body_done;
+    char *body_buf;
+    char rx[HTTP_SHIM_RX_SIZE];
+    size_t rx_pos;
+    size_t rx_len;
+};
+
+static char server_host[HTTP_SHIM_HOST_SIZE];
+static int server_port;
+
+esp_err_t hostShimSetServer(const char *host, int port){
+    if(host == NULL || strlen(host) >= sizeof(server_host) || port <= 0 || port > 65535){
+        return ESP_ERR_INVALID_ARG;
+    }
+    strcpy(server_host, host);
+    server_port = port;
+    return ESP_OK;
+}
+
+esp_err_t hostShimParseServer(const char *server){
+    const char *colon = server != NULL ? strrchr(server, ':') : NULL;
+    if(colon == NULL || colon == server || (size_t)(colon - server) >= sizeof(server_host)){
+        return ESP_ERR_INVALID_ARG;
+    }
+    char host[HTTP_SHIM_HOST_SIZE];
+    memcpy(host, server, colon - server);
+    host[colon - server] = '\0';
+    return hostShimSetServer(host, atoi(colon + 1));
+}
+
+static void resolve_server(void){
+    if(server_port != 0){
+        return;
+    }
+    const char *env = getenv("PUBSUB_HOST_SERVER");
+    if(env == NULL || hostShimParseServer(env) != ESP_OK){
+        hostShimSetServer(HOST_SHIM_DEFAULT_HOST, HOST_SHIM_DEFAULT_PORT);
+    }
+}
+
+static esp_err_t dispatch(esp_http_client_handle_t client, esp_http_client_event_id_t id, void *data, int len,
+                          char *key, char *value){
+    if(client->config.event_handler == NULL){
+        return ESP_OK;
+    }
+    esp_http_client_event_t evt = {
+        .event_id = id,
+        .client = client,
+        .data = data,
+        .data_len = len,
+        .user_data = client->config.user_data,
+        .header_key = key,
+        .header_value = value,
+    };
+    return client->config.event_handler(&evt);
+}
+
+// Splits scheme://host[:port]/path; only the host and path are kept.
+static esp_err_t parse_url(esp_http_client_handle_t client, const char *url){
+    const char *host = strstr(url, "://");
+    host = host != NULL ? host + 3 : url;
+    const char *path = strchr(host, '/');
+    size_t host_len = path != NULL ? (size_t)(path - host) : strlen(host);
+    if(host_len == 0 || host_len >= sizeof(client->host)){
+        return ESP_ERR_INVALID_ARG;
+    }
+    char *copy = strdup(path != NULL ? path : "/");
+    if(copy == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+    free(client->path);
+    client->path = copy;
+    memcpy(client->host, host, host_len);
+    client->host[host_len] = '\0';
+    return ESP_OK;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config){
+    if(config == NULL || config->url == NULL){
+        return NULL;
+    }
+    esp_http_client_handle_t client = (esp_http_client_handle_t)calloc(1, sizeof(struct esp_http_client));
+    if(client == NULL){
+        return NULL;
+    }
+    client->config = *config;
+    client->config.url = NULL;
+    if(client->config.timeout_ms <= 0){
+        client->config.timeout_ms = HTTP_SHIM_DEFAULT_TIMEOUT_MS;
+    }
+    if(client->config.buffer_size <= 0){
+        client->config.buffer_size = HTTP_SHIM_DEFAULT_BUFFER_SIZE;
+    }
+    client->method = config->method;
+    client->fd = -1;
+    client->body_buf = (char *)malloc(client->config.buffer_size);
+    if(client->body_buf == NULL || parse_url(client, config->url) != ESP_OK){
+        free(client->body_buf);
+        free(client->path);
+        free(client);
+        return NULL;
+    }
+    resolve_server();
+    return client;
+}
+
+static esp_err_t shim_connect(esp_http_client_handle_t client){
+    if(client->fd >= 0){
+        return ESP_OK;
+    }
+    char port[8];
+    snprintf(port, sizeof(port), "%d", server_port);
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res = NULL;
+    if(getaddrinfo(server_host, port, &hints, &res) != 0){
+        ESP_LOGE(TAG, "Cannot resolve %s", server_host);
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    int fd = -1;
+    for(struct addrinfo *ai = res; ai != NULL && fd < 0; ai = ai->ai_next){
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if(fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0){
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if(fd < 0){
+        ESP_LOGE(TAG, "Connection to %s:%d failed: %s", server_host, server_port, strerror(errno));
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    struct timeval tv = { .tv_sec = client->config.timeout_ms / 1000,
+                          .tv_usec = (client->config.timeout_ms % 1000) * 1000 };
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if(client->config.keep_alive_enable){
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+    }
+    client->fd = fd;
+    client->rx_pos = client->rx_len = 0;
+    dispatch(client, HTTP_EVENT_ON_CONNECTED, NULL, 0, NULL, NULL);
+    return ESP_OK;
+}
+
+static bool send_all(esp_http_client_handle_t client, const char *data, size_t len){
+    while(len > 0){
+        ssize_t n = send(client->fd, data, len, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR){
+            continue;
+        }
+        if(n <= 0){
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static esp_err_t send_request_headers(esp_http_client_handle_t client, int write_len){
+    size_t size = strlen(client->path) + strlen(client->host) + 128;
+    for(int i = 0; i < HTTP_SHIM_MAX_HEADERS; i++){
+        if(client->headers[i].key != NULL){
+            size += strlen(client->headers[i].key) + strlen(client->headers[i].value) + 4;
+        }
+    }
+    char *buf = (char *)malloc(size);
+    if(buf == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+    int len = snprintf(buf, size, "%s %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: ESP32 HTTP Client/1.0\r\n",
+                       method_names[client->method], client->path, client->host);
+    for(int i = 0; i < HTTP_SHIM_MAX_HEADERS; i++){
+        if(client->headers[i].key != NULL){
+            len += snprintf(buf + len, size - len, "%s: %s\r\n", client->headers[i].key, client->headers[i].value);
+        }
+    }
+    if(write_len >= 0){
+        len += snprintf(buf + len, size - len, "Content-Length: %d\r\n\r\n", write_len);
+    }else{
+        len += snprintf(buf + len, size - len, "Transfer-Encoding: chunked\r\n\r\n");
+    }
+    client->status_code = 0;
+    client->content_length = 0;
+    client->chunked = false;
+    client->connection_close = false;
+    client->body_done = false;
+    bool ok = send_all(client, buf, len);
+    free(buf);
+    if(!ok){
+        dispatch(client, HTTP_EVENT_ERROR, NULL, 0, NULL, NULL);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+    dispatch(client, HTTP_EVENT_HEADERS_SENT, NULL, 0, NULL, NULL);
+    return ESP_OK;
+}
+
+// Tops up the receive buffer; false on timeout, error or a closed connection.
+static bool fill_rx(esp_http_client_handle_t client){
+    if(client->rx_pos == client->rx_len){
+        client->rx_pos = client->rx_len = 0;
+    }
+    if(client->rx_len == sizeof(client->rx)){
+        memmove(client->rx, client->rx + client->rx_pos, client->rx_len - client->rx_pos);
+        client->rx_len -= client->rx_pos;
+        client->rx_pos = 0;
+    }
+    while(true){
+        ssize_t n = recv(client->fd, client->rx + client->rx_len, sizeof(client->rx) - client->rx_len, 0);
+        if(n < 0 && errno == EINTR){
+            continue;
+        }
+        if(n <= 0){
+            return false;
+        }
+        client->rx_len += n;
+        return true;
+    }
+}
+
+// Reads one CRLF-terminated line without the terminator; -1 on failure.
+static int read_line(esp_http_client_handle_t client, char *line, size_t size){
+    size_t len = 0;
+    while(true){
+        while(client->rx_pos < client->rx_len){
+            char c = client->rx[client->rx_pos++];
+            if(c == '\n'){
+                if(len > 0 && line[len - 1] == '\r'){
+                    len--;
+                }
+                line[len] = '\0';
+                return (int)len;
+            }
+            if(len + 1 >= size){
+                return -1;
+            }
+            line[len++] = c;
+        }
+        if(!fill_rx(client)){
+            return -1;
+        }
+    }
+}
+
+static esp_err_t read_response_headers(esp_http_client_handle_t client){
+    char line[HTTP_SHIM_LINE_SIZE];
+    if(client->fd < 0 || read_line(client, line, sizeof(line)) < 0 ||
+       sscanf(line, "HTTP/%*d.%*d %d", &client->status_code) != 1){
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+    client->content_length = -1;
+    while(true){
+        int len = read_line(client, line, sizeof(line));
+        if(len < 0){
+            return ESP_ERR_HTTP_FETCH_HEADER;
+        }
+        if(len == 0){
+            break;
+        }
+        char *value = strchr(line, ':');
+        if(value == NULL){
+            continue;
+        }
+        *value++ = '\0';
+        while(*value == ' ' || *value == '\t'){
+            value++;
+        }
+        if(strcasecmp(line, "Content-Length") == 0){
+            client->content_length = strtoll(value, NULL, 10);
+        }else if(strcasecmp(line, "Transfer-Encoding") == 0 && strcasecmp(value, "chunked") == 0){
+            client->chunked = true;
+        }else if(strcasecmp(line, "Connection") == 0 && strcasecmp(value, "close") == 0){
+            client->connection_close = true;
+        }
+        dispatch(client, HTTP_EVENT_ON_HEADER, NULL, 0, line, value);
+    }
+    if(client->chunked){
+        client->content_length = -1;
+        client->body_left = 0;
+    }else if(client->content_length >= 0){
+        client->body_left = client->content_length;
+    }else if(client->method == HTTP_METHOD_HEAD || client->status_code == 204 || client->status_code == 304){
+        client->body_left = 0;
+    }else{
+        // Neither length nor chunks: the body runs until the server closes.
+        client->body_left = -1;
+        client->connection_close = true;
+    }
+    client->body_done = !client->chunked && client->body_left == 0;
+    return ESP_OK;
+}
+
+// Copies up to len body bytes into buf, de-chunking on the way. 0 at the end, -1 on error.
+static int read_body(esp_http_client_handle_t client, char *buf, int len){
+    char line[HTTP_SHIM_LINE_SIZE];
+    if(client->body_done){
+        return 0;
+    }
+    if(client->chunked && client->body_left == 0){
+        int n = read_line(client, line, sizeof(line));
+        if(n == 0){
+            // The CRLF that ends the previous chunk.
+            n = read_line(client, line, sizeof(line));
+        }
+        if(n < 0){
+            return -1;
+        }
+        client->body_left = strtoll(line, NULL, 16);
+        if(client->body_left == 0){
+            while((n = read_line(client, line, sizeof(line))) > 0){
+                // Trailers are ignored.
+            }
+            client->body_done = true;
+            return n < 0 ? -1 : 0;
+        }
+    }
+    if(client->rx_pos == client->rx_len && !fill_rx(client)){
+        if(client->body_left < 0){
+            client->body_done = true;
+            return 0;
+        }
+        return -1;
+    }
+    size_t avail = client->rx_len - client->rx_pos;
+    size_t n = (size_t)len < avail ? (size_t)len : avail;
+    if(client->body_left >= 0 && (int64_t)n > client->body_left){
+        n = (size_t)client->body_left;
+    }
+    memcpy(buf, client->rx + client->rx_pos, n);
+    client->rx_pos += n;
+    if(client->body_left > 0){
+        client->body_left -= n;
+        if(client->body_left == 0 && !client->chunked){
+            client->body_done = true;
+        }
+    }
+    return (int)n;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client){
+    if(client == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = shim_connect(client);
+    if(err == ESP_OK){
+        err = send_request_headers(client, client->post_data != NULL ? client->post_len : 0);
+    }
+    if(err == ESP_OK && client->post_len > 0 && !send_all(client, client->post_data, client->post_len)){
+        err = ESP_ERR_HTTP_WRITE_DATA;
+    }
+    if(err == ESP_OK){
+        err = read_response_headers(client);
+    }
+    while(err == ESP_OK){
+        int n = read_body(client, client->body_buf, client->config.buffer_size);
+        if(n < 0){
+            err = ESP_ERR_HTTP_CONNECTION_CLOSED;
+        }else if(n == 0){
+            break;
+        }else{
+            dispatch(client, HTTP_EVENT_ON_DATA, client->body_buf, n, NULL, NULL);
+        }
+    }
+    if(err != ESP_OK){
+        ESP_LOGW(TAG, "perform failed: %s", esp_err_to_name(err));
+        dispatch(client, HTTP_EVENT_ERROR, NULL, 0, NULL, NULL);
+        return err;
+    }
+    dispatch(client, HTTP_EVENT_ON_FINISH, NULL, 0, NULL, NULL);
+    if(client->connection_close){
+        esp_http_client_close(client);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len){
+    if(client == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = shim_connect(client);
+    return err != ESP_OK ? err : send_request_headers(client, write_len);
+}
+
+int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, int len){
+    if(client == NULL || client->fd < 0){
+        return -1;
+    }
+    return send_all(client, buffer, len) ? len : -1;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client){
+    if(client == NULL || read_response_headers(client) != ESP_OK){
+        return ESP_FAIL;
+    }
+    return client->content_length < 0 ? 0 : client->content_length;
+}
+
+int esp_http_client_read_response(esp_http_client_handle_t client, char *buffer, int len){
+    int total = 0;
+    while(total < len){
+        int n = read_body(client, buffer + total, len - total);
+        if(n < 0){
+            return ESP_FAIL;
+        }
+        if(n == 0){
+            break;
+        }
+        dispatch(client, HTTP_EVENT_ON_DATA, buffer + total, n, NULL, NULL);
+        total += n;
+    }
+    return total;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url){
+    if(client == NULL || url == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    char old_host[HTTP_SHIM_HOST_SIZE];
+    strcpy(old_host, client->host);
+    esp_err_t err = parse_url(client, url);
+    if(err == ESP_OK && strcmp(old_host, client->host) != 0){
+        // Like the device client, a new host means a new connection.
+        esp_http_client_close(client);
+    }
+    return err;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method){
+    if(client == NULL || method >= HTTP_METHOD_MAX){
+        return ESP_ERR_INVALID_ARG;
+    }
+    client->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value){
+    if(client == NULL || key == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    HttpHeader *slot = NULL;
+    for(int i = 0; i < HTTP_SHIM_MAX_HEADERS; i++){
+        HttpHeader *h = &client->headers[i];
+        if(h->key != NULL && strcasecmp(h->key, key) == 0){
+            slot = h;
+            break;
+        }
+        if(h->key == NULL && slot == NULL){
+            slot = h;
+        }
+    }
+    if(slot == NULL){
+        return ESP_ERR_NO_MEM;
+    }
+    free(slot->key);
+    free(slot->value);
+    slot->key = slot->value = NULL;
+    if(value == NULL){
+        return ESP_OK;
+    }
+    slot->key = strdup(key);
+    slot->value = strdup(value);
+    if(slot->key == NULL || slot->value == NULL){
+        free(slot->key);
+        free(slot->value);
+        slot->key = slot->value = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len){
+    if(client == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    client->post_data = data;
+    client->post_len = data != NULL ? len : 0;
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client){
+    return client != NULL ? client->status_code : -1;
+}
+
+int64_t esp_http_client_get_content_length(esp_http_client_handle_t client){
+    return client != NULL ? client->content_length : -1;
+}
+
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client){
+    return client != NULL && client->chunked;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client){
+    if(client == NULL){
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(client->fd >= 0){
+        close(client->fd);
+        client->fd = -1;
+        client->rx_pos = client->rx_len = 0;
+        dispatch(client, HTTP_EVENT_DISCONNECTED, NULL, 0, NULL, NULL);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client){
+    if(client == NULL){
+        return ESP_FAIL;
+    }
+    esp_http_client_close(client);
+    for(int i = 0; i < HTTP_SHIM_MAX_HEADERS; i++){
+        free(client->headers[i].key);
+        free(client->headers[i].value);
+    }
+    free(client->body_buf);
+    free(client->path);
+    free(client);
+    return ESP_OK;
+}
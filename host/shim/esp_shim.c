@@ -0,0 +1,159 @@
+/**
+ * esp_shim.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+
+typedef struct{
+    esp_err_t code;
+    const char *name;
+}esp_err_msg_t;
+
+#define ERR_TBL_IT(err) { err, #err }
+
+static const esp_err_msg_t esp_err_msg_table[] = {
+    ERR_TBL_IT(ESP_OK),
+    ERR_TBL_IT(ESP_FAIL),
+    ERR_TBL_IT(ESP_ERR_NO_MEM),
+    ERR_TBL_IT(ESP_ERR_INVALID_ARG),
+    ERR_TBL_IT(ESP_ERR_INVALID_STATE),
+    ERR_TBL_IT(ESP_ERR_INVALID_SIZE),
+    ERR_TBL_IT(ESP_ERR_NOT_FOUND),
+    ERR_TBL_IT(ESP_ERR_NOT_SUPPORTED),
+    ERR_TBL_IT(ESP_ERR_TIMEOUT),
+    ERR_TBL_IT(ESP_ERR_INVALID_RESPONSE),
+    ERR_TBL_IT(ESP_ERR_INVALID_CRC),
+    ERR_TBL_IT(ESP_ERR_INVALID_VERSION),
+    ERR_TBL_IT(ESP_ERR_INVALID_MAC),
+    ERR_TBL_IT(ESP_ERR_NOT_FINISHED),
+    ERR_TBL_IT(ESP_ERR_HTTP_MAX_REDIRECT),
+    ERR_TBL_IT(ESP_ERR_HTTP_CONNECT),
+    ERR_TBL_IT(ESP_ERR_HTTP_WRITE_DATA),
+    ERR_TBL_IT(ESP_ERR_HTTP_FETCH_HEADER),
+    ERR_TBL_IT(ESP_ERR_HTTP_INVALID_TRANSPORT),
+    ERR_TBL_IT(ESP_ERR_HTTP_CONNECTING),
+    ERR_TBL_IT(ESP_ERR_HTTP_EAGAIN),
+    ERR_TBL_IT(ESP_ERR_HTTP_CONNECTION_CLOSED),
+};
+
+const char *esp_err_to_name(esp_err_t code){
+    for(size_t i = 0; i < sizeof(esp_err_msg_table) / sizeof(esp_err_msg_table[0]); i++){
+        if(esp_err_msg_table[i].code == code){
+            return esp_err_msg_table[i].name;
+        }
+    }
+    return "UNKNOWN ERROR";
+}
+
+static int64_t monotonic_us(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t start_us = -1;
+
+int64_t esp_timer_get_time(void){
+    if(start_us < 0){
+        start_us = monotonic_us();
+    }
+    return monotonic_us() - start_us;
+}
+
+uint32_t esp_log_timestamp(void){
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+#define LOG_TAG_LEVELS 8
+
+static int log_level = -1;
+static struct{
+    const char *tag;
+    esp_log_level_t level;
+}tag_levels[LOG_TAG_LEVELS];
+static size_t tag_level_count;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level){
+    if(strcmp(tag, "*") == 0){
+        log_level = level;
+        return;
+    }
+    for(size_t i = 0; i < tag_level_count; i++){
+        if(strcmp(tag_levels[i].tag, tag) == 0){
+            tag_levels[i].level = level;
+            return;
+        }
+    }
+    if(tag_level_count < LOG_TAG_LEVELS){
+        tag_levels[tag_level_count].tag = tag;
+        tag_levels[tag_level_count].level = level;
+        tag_level_count++;
+    }
+}
+
+esp_log_level_t esp_log_level_get(const char *tag){
+    for(size_t i = 0; i < tag_level_count; i++){
+        if(strcmp(tag_levels[i].tag, tag) == 0){
+            return tag_levels[i].level;
+        }
+    }
+    if(log_level < 0){
+        const char *env = getenv("PUBSUB_HOST_LOG_LEVEL");
+        log_level = env != NULL ? atoi(env) : ESP_LOG_WARN;
+    }
+    return (esp_log_level_t)log_level;
+}
+
+uint32_t esp_random(void){
+    uint32_t value;
+    esp_fill_random(&value, sizeof(value));
+    return value;
+}
+
+void esp_fill_random(void *buf, size_t len){
+    FILE *f = fopen("/dev/urandom", "rb");
+    if(f == NULL || fread(buf, 1, len, f) != len){
+        // Good enough for test payloads if /dev/urandom is unavailable.
+        for(size_t i = 0; i < len; i++){
+            ((uint8_t *)buf)[i] = (uint8_t)rand();
+        }
+    }
+    if(f != NULL){
+        fclose(f);
+    }
+}
+
+size_t heap_caps_get_allocated_size(void *ptr){
+    return malloc_usable_size(ptr);
+}
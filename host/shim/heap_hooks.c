@@ -0,0 +1,75 @@
+/**
+ * heap_hooks.c
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+/*
+ * malloc and friends for programs linked with
+ * -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free,--wrap=strdup
+ * so that they call the heap hooks like ESP-IDF does. Only calls made from
+ * objects in the link are wrapped; shared libraries allocate unseen.
+ */
+#include <string.h>
+#include "esp_heap_caps.h"
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size){
+    void *ptr = __real_malloc(size);
+    esp_heap_trace_alloc_hook(ptr, size, 0);
+    return ptr;
+}
+
+void *__wrap_calloc(size_t n, size_t size){
+    void *ptr = __real_calloc(n, size);
+    esp_heap_trace_alloc_hook(ptr, n * size, 0);
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size){
+    // Counted as a free and a new allocation, the block may have moved.
+    if(ptr != NULL){
+        esp_heap_trace_free_hook(ptr);
+    }
+    void *moved = __real_realloc(ptr, size);
+    esp_heap_trace_alloc_hook(moved, size, 0);
+    return moved;
+}
+
+void __wrap_free(void *ptr){
+    esp_heap_trace_free_hook(ptr);
+    __real_free(ptr);
+}
+
+char *__wrap_strdup(const char *str){
+    size_t len = strlen(str) + 1;
+    char *copy = (char *)__wrap_malloc(len);
+    if(copy != NULL){
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
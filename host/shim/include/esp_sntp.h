@@ -0,0 +1,53 @@
+/**
+ * esp_sntp.h
+ *
+ * Created on: 17.10.2026
+ *
+ * Copyright (c) 2026 Eugin Francis. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef ESP_SNTP_H
+#define ESP_SNTP_H
+
+#include <time.h>
+
+/*
+ * The host clock is already synchronised, so SNTP is a no-op that reports
+ * completion straight away and time() is used as it is.
+ */
+typedef enum{
+    ESP_SNTP_OPMODE_POLL,
+    ESP_SNTP_OPMODE_LISTENONLY
+}esp_sntp_operatingmode_t;
+
+typedef enum{
+    SNTP_SYNC_STATUS_RESET,
+    SNTP_SYNC_STATUS_COMPLETED,
+    SNTP_SYNC_STATUS_IN_PROGRESS
+}sntp_sync_status_t;
+
+static inline void esp_sntp_setoperatingmode(esp_sntp_operatingmode_t mode){ (void)mode; }
+static inline void esp_sntp_setservername(unsigned char idx, const char *server){ (void)idx; (void)server; }
+static inline void esp_sntp_init(void){}
+static inline void esp_sntp_stop(void){}
+static inline sntp_sync_status_t sntp_get_sync_status(void){ return SNTP_SYNC_STATUS_COMPLETED; }
+
+#endif // ESP_SNTP_H